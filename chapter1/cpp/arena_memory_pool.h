@@ -0,0 +1,201 @@
+// MIT License
+//
+// Copyright (c) 2024 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/memory_pool.h>
+#include <arrow/status.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A MemoryPool for batches that all die at the same time. Allocations are
+// carved out of large slabs taken from an upstream pool by bumping a cursor,
+// Free only gives memory back when it is the most recent allocation, and
+// Reallocate grows the most recent allocation in place when the slab has room,
+// which is the common case for a single builder growing its buffers.
+// Everything is returned to the upstream pool at once by Reset or when the
+// arena is destroyed, so no buffer allocated from it may outlive it.
+class ArenaMemoryPool : public arrow::MemoryPool {
+ public:
+  static constexpr int64_t kDefaultSlabSize = 4 << 20;
+
+  explicit ArenaMemoryPool(int64_t slab_size = kDefaultSlabSize,
+                           arrow::MemoryPool* upstream = arrow::default_memory_pool())
+      : slab_size_(slab_size), upstream_(upstream) {}
+
+  ~ArenaMemoryPool() override { release_slabs(0); }
+
+  using arrow::MemoryPool::Allocate;
+  using arrow::MemoryPool::Free;
+  using arrow::MemoryPool::Reallocate;
+
+  arrow::Status Allocate(int64_t size, int64_t alignment, uint8_t** out) override {
+    if (size < 0) {
+      return arrow::Status::Invalid("negative allocation size");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ARROW_RETURN_NOT_OK(bump(size, alignment, out));
+    record_allocation(size);
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Reallocate(int64_t old_size, int64_t new_size, int64_t alignment,
+                           uint8_t** ptr) override {
+    if (new_size < 0) {
+      return arrow::Status::Invalid("negative allocation size");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_last(*ptr, old_size) && *ptr + new_size <= end_) {
+      // the common builder pattern, just move the cursor
+      cursor_ = *ptr + new_size;
+    } else if (new_size > old_size) {
+      uint8_t* moved;
+      ARROW_RETURN_NOT_OK(bump(new_size, alignment, &moved));
+      std::memcpy(moved, *ptr, std::min(old_size, new_size));
+      *ptr = moved;
+    }
+    record_allocation(new_size - old_size);
+    return arrow::Status::OK();
+  }
+
+  void Free(uint8_t* buffer, int64_t size, int64_t alignment) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_last(buffer, size)) {
+      cursor_ = buffer;
+    }
+    bytes_allocated_ -= size;
+  }
+
+  // Returns every slab but the first to the upstream pool and starts over.
+  // Fails if buffers allocated from the arena are still alive.
+  arrow::Status Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bytes_allocated_ != 0) {
+      return arrow::Status::Invalid("arena reset with ", bytes_allocated_,
+                                    " bytes still in use");
+    }
+    release_slabs(1);
+    if (!slabs_.empty()) {
+      cursor_ = slabs_[0].data;
+      end_ = slabs_[0].data + slabs_[0].size;
+    }
+    return arrow::Status::OK();
+  }
+
+  int64_t bytes_allocated() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_allocated_;
+  }
+  int64_t max_memory() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_memory_;
+  }
+  int64_t total_bytes_allocated() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_bytes_allocated_;
+  }
+  int64_t num_allocations() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_allocations_;
+  }
+  std::string backend_name() const override {
+    return "arena(" + upstream_->backend_name() + ")";
+  }
+
+  // number of slabs currently held from the upstream pool
+  int64_t num_slabs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int64_t>(slabs_.size());
+  }
+
+ private:
+  struct slab {
+    uint8_t* data;
+    int64_t size;
+  };
+
+  bool is_last(const uint8_t* buffer, int64_t size) const {
+    return buffer + size == cursor_;
+  }
+
+  arrow::Status bump(int64_t size, int64_t alignment, uint8_t** out) {
+    alignment = std::max<int64_t>(alignment, arrow::kDefaultBufferAlignment);
+    uint8_t* aligned = align_up(cursor_, alignment);
+    if (cursor_ == nullptr || aligned + size > end_) {
+      // oversized requests get a slab of their own
+      ARROW_RETURN_NOT_OK(add_slab(std::max(slab_size_, size + alignment)));
+      aligned = align_up(cursor_, alignment);
+    }
+    *out = aligned;
+    cursor_ = aligned + size;
+    return arrow::Status::OK();
+  }
+
+  arrow::Status add_slab(int64_t size) {
+    uint8_t* data;
+    ARROW_RETURN_NOT_OK(upstream_->Allocate(size, &data));
+    slabs_.push_back({data, size});
+    cursor_ = data;
+    end_ = data + size;
+    return arrow::Status::OK();
+  }
+
+  void release_slabs(size_t keep) {
+    while (slabs_.size() > keep) {
+      upstream_->Free(slabs_.back().data, slabs_.back().size);
+      slabs_.pop_back();
+    }
+    if (slabs_.empty()) {
+      cursor_ = end_ = nullptr;
+    }
+  }
+
+  void record_allocation(int64_t delta) {
+    bytes_allocated_ += delta;
+    max_memory_ = std::max(max_memory_, bytes_allocated_);
+    if (delta > 0) total_bytes_allocated_ += delta;
+    ++num_allocations_;
+  }
+
+  static uint8_t* align_up(uint8_t* p, int64_t alignment) {
+    auto addr = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<uint8_t*>((addr + alignment - 1) & ~(alignment - 1));
+  }
+
+  const int64_t slab_size_;
+  arrow::MemoryPool* upstream_;
+
+  mutable std::mutex mutex_;
+  std::vector<slab> slabs_;
+  uint8_t* cursor_ = nullptr;
+  uint8_t* end_ = nullptr;
+
+  int64_t bytes_allocated_ = 0;
+  int64_t max_memory_ = 0;
+  int64_t total_bytes_allocated_ = 0;
+  int64_t num_allocations_ = 0;
+};
@@ -0,0 +1,128 @@
+// MIT License
+//
+// Copyright (c) 2024 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <arrow/api.h>
+#include <arrow/util/logging.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "arena_memory_pool.h"
+#include "data_row.h"
+
+// Runs the chapter 1 workloads repeatedly, each iteration building its batches
+// and dropping them like a request would, once with the default pool and once
+// with an ArenaMemoryPool that is reset between iterations. Reports the mean
+// latency per iteration and how many allocations reached the default pool.
+// Usage: arena_pool_bench [iterations], default 200.
+
+void random_data(arrow::MemoryPool* pool) {
+  arrow::DoubleBuilder builder{arrow::float64(), pool};
+  arrow::ArrayVector columns(16);
+  for (int i = 0; i < 16; ++i) {
+    for (int j = 0; j < 8192; ++j) {
+      ARROW_CHECK_OK(builder.Append(j * 0.5));
+    }
+    ARROW_CHECK_OK(builder.Finish(&columns[i]));
+  }
+}
+
+void data_rows(arrow::MemoryPool* pool, const std::vector<data_row>& rows) {
+  auto batch = build_data_row_batch(rows.data(), rows.size(), pool).ValueOrDie();
+  ARROW_CHECK_EQ(batch->num_rows(), static_cast<int64_t>(rows.size()));
+}
+
+void struct_builder(arrow::MemoryPool* pool) {
+  using arrow::field;
+  auto type = arrow::struct_({field("archer", arrow::utf8()),
+                              field("location", arrow::utf8()),
+                              field("year", arrow::int16())});
+  std::unique_ptr<arrow::ArrayBuilder> tmp;
+  ARROW_CHECK_OK(arrow::MakeBuilder(pool, type, &tmp));
+  auto builder = static_cast<arrow::StructBuilder*>(tmp.get());
+  auto archer = static_cast<arrow::StringBuilder*>(builder->field_builder(0));
+  auto location = static_cast<arrow::StringBuilder*>(builder->field_builder(1));
+  auto year = static_cast<arrow::Int16Builder*>(builder->field_builder(2));
+  for (int i = 0; i < 10000; ++i) {
+    ARROW_CHECK_OK(builder->Append());
+    ARROW_CHECK_OK(archer->Append("Legolas"));
+    ARROW_CHECK_OK(location->Append("Murkwood"));
+    ARROW_CHECK_OK(year->Append(1954));
+  }
+  std::shared_ptr<arrow::Array> out;
+  ARROW_CHECK_OK(builder->Finish(&out));
+}
+
+void run(const std::string& name, int iterations,
+         const std::function<void(arrow::MemoryPool*)>& workload) {
+  arrow::MemoryPool* system = arrow::default_memory_pool();
+  std::cout << name << std::endl;
+
+  {
+    const int64_t allocations = system->num_allocations();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      workload(system);
+    }
+    std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "  default pool: " << elapsed.count() / iterations << " us/iter, "
+              << (system->num_allocations() - allocations) / iterations
+              << " allocations/iter" << std::endl;
+  }
+
+  {
+    ArenaMemoryPool arena;
+    const int64_t allocations = system->num_allocations();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      workload(&arena);
+      ARROW_CHECK_OK(arena.Reset());
+    }
+    std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "  arena pool:   " << elapsed.count() / iterations << " us/iter, "
+              << static_cast<double>(system->num_allocations() - allocations) /
+                     iterations
+              << " allocations/iter (" << arena.num_allocations() / iterations
+              << " served by the arena, " << arena.num_slabs() << " slab(s) kept)"
+              << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  const int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+
+  std::vector<data_row> rows;
+  for (int64_t i = 0; i < 1 << 16; ++i) {
+    rows.push_back({i, 1 + i % 4, std::vector<double>(1 + i % 4, 0.5 * i)});
+  }
+
+  run("random_data_example (16 x 8192 doubles)", iterations, random_data);
+  run("build_data_row_batch (64K rows)", iterations,
+      [&](arrow::MemoryPool* pool) { data_rows(pool, rows); });
+  run("build_struct_builder (10K structs)", iterations, struct_builder);
+}
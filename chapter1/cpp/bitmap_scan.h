@@ -0,0 +1,80 @@
+// MIT License
+//
+// Copyright (c) 2024 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/array.h>
+#include <arrow/util/bit_block_counter.h>
+#include <arrow/util/bit_util.h>
+
+#include <cstdint>
+#include <utility>
+
+// Walks a validity bitmap 64 bits at a time and calls visit_run(start, length)
+// for every run of valid positions in [0, length), relative to the array (not
+// the bitmap) offset. Words that are entirely valid become a single run without
+// looking at the individual bits, words that are entirely null are skipped, and
+// only mixed words are split bit by bit. A null bitmap means everything is
+// valid and results in runs of up to 32K positions.
+template <typename VisitRun>
+void visit_valid_runs(const uint8_t* validity, int64_t offset, int64_t length,
+                      VisitRun&& visit_run) {
+  arrow::internal::OptionalBitBlockCounter counter(validity, offset, length);
+  int64_t position = 0;
+  while (position < length) {
+    arrow::internal::BitBlockCount block = counter.NextBlock();
+    if (block.AllSet()) {
+      visit_run(position, block.length);
+    } else if (!block.NoneSet()) {
+      int64_t run_start = -1;
+      for (int64_t i = position; i < position + block.length; ++i) {
+        if (arrow::bit_util::GetBit(validity, offset + i)) {
+          if (run_start < 0) run_start = i;
+        } else if (run_start >= 0) {
+          visit_run(run_start, i - run_start);
+          run_start = -1;
+        }
+      }
+      if (run_start >= 0) {
+        visit_run(run_start, position + block.length - run_start);
+      }
+    }
+    position += block.length;
+  }
+}
+
+// Same as above for the rows [start, start + length) of an array, the runs
+// passed to visit_run are relative to the start of the array.
+template <typename VisitRun>
+void visit_valid_runs(const arrow::Array& array, int64_t start, int64_t length,
+                      VisitRun&& visit_run) {
+  const uint8_t* validity = array.null_count() > 0 ? array.null_bitmap_data() : nullptr;
+  visit_valid_runs(validity, array.offset() + start, length,
+                   [&](int64_t run_start, int64_t run_length) {
+                     visit_run(start + run_start, run_length);
+                   });
+}
+
+template <typename VisitRun>
+void visit_valid_runs(const arrow::Array& array, VisitRun&& visit_run) {
+  visit_valid_runs(array, 0, array.length(), std::forward<VisitRun>(visit_run));
+}
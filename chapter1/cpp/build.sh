@@ -24,5 +24,15 @@
 
 # the second line adds a linker option specifying the rpath so we don't
 # need to worry about the LD_LIBRARY_PATH when running the executable
-g++ examples.cc -o examples `pkg-config --cflags --libs arrow` \
+g++ examples.cc -std=c++20 -o examples `pkg-config --cflags --libs arrow` \
+    -Wl,-rpath=`pkg-config --libs-only-L arrow | cut -c 3-`
+g++ row_conversion_bench.cc -std=c++20 -O3 -o row_conversion_bench `pkg-config --cflags --libs arrow` \
+    -Wl,-rpath=`pkg-config --libs-only-L arrow | cut -c 3-`
+g++ random_columns_bench.cc -std=c++20 -O3 -o random_columns_bench `pkg-config --cflags --libs arrow` \
+    -Wl,-rpath=`pkg-config --libs-only-L arrow | cut -c 3-`
+g++ validity_scan_bench.cc -std=c++20 -O3 -o validity_scan_bench `pkg-config --cflags --libs arrow` \
+    -Wl,-rpath=`pkg-config --libs-only-L arrow | cut -c 3-`
+g++ struct_builder_bench.cc -std=c++20 -O3 -o struct_builder_bench `pkg-config --cflags --libs arrow` \
+    -Wl,-rpath=`pkg-config --libs-only-L arrow | cut -c 3-`
+g++ arena_pool_bench.cc -std=c++20 -O3 -o arena_pool_bench `pkg-config --cflags --libs arrow` \
     -Wl,-rpath=`pkg-config --libs-only-L arrow | cut -c 3-`
@@ -0,0 +1,320 @@
+// MIT License
+//
+// Copyright (c) 2024 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <arrow/array.h>
+#include <arrow/builder.h>
+#include <arrow/record_batch.h>
+#include <arrow/util/bit_util.h>
+#include <arrow/util/parallel.h>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "bitmap_scan.h"
+#include "row_converter.h"
+
+struct data_row {
+  int64_t id;
+  int64_t components;
+  std::vector<double> component_cost;
+};
+
+// the same layout, described at compile time so that rows_to_table can
+// write the columns directly without going through the builders
+template <>
+struct row_layout<data_row> {
+  static constexpr auto columns =
+      std::make_tuple(column("id", &data_row::id),
+                      column("components", &data_row::components),
+                      column("component_cost", &data_row::component_cost));
+};
+
+inline std::shared_ptr<arrow::Schema> data_row_schema() {
+  return arrow::schema(
+      {arrow::field("id", arrow::int64()), arrow::field("components", arrow::int64()),
+       arrow::field("component_cost", arrow::list(arrow::float64()))});
+}
+
+// builds a single record batch out of the n rows starting at `rows`
+inline arrow::Result<std::shared_ptr<arrow::RecordBatch>> build_data_row_batch(
+    const data_row* rows, int64_t n, arrow::MemoryPool* pool) {
+  using arrow::DoubleBuilder;
+  using arrow::Int64Builder;
+  using arrow::ListBuilder;
+  using arrow::RecordBatchBuilder;
+
+  ARROW_ASSIGN_OR_RAISE(auto record_bldr,
+                        RecordBatchBuilder::Make(data_row_schema(), pool, n));
+  auto id_bldr = record_bldr->GetFieldAs<Int64Builder>(0);
+  auto comp_bldr = record_bldr->GetFieldAs<Int64Builder>(1);
+  auto comp_cost_bldr = record_bldr->GetFieldAs<ListBuilder>(2);
+  auto comp_item_cost_bldr =
+      (static_cast<DoubleBuilder*>(comp_cost_bldr->value_builder()));
+
+  // just loop over existing data and insert it, check return values in case
+  // we can't allocate enough additional memory
+  for (const data_row* row = rows; row != rows + n; ++row) {
+    ARROW_RETURN_NOT_OK(id_bldr->Append(row->id));
+    ARROW_RETURN_NOT_OK(comp_bldr->Append(row->components));
+
+    // start a new list
+    ARROW_RETURN_NOT_OK(comp_cost_bldr->Append());
+    // add actual values
+    ARROW_RETURN_NOT_OK(comp_item_cost_bldr->AppendValues(row->component_cost.data(),
+                                                          row->component_cost.size()));
+  }
+
+  return record_bldr->Flush();
+}
+
+inline arrow::Result<std::shared_ptr<arrow::Table>> vector_to_columnar(
+    const std::vector<data_row>& rows) {
+  // the builders are more efficient since they use the memory pools
+  arrow::MemoryPool* pool = arrow::default_memory_pool();
+
+  ARROW_ASSIGN_OR_RAISE(auto rec, build_data_row_batch(rows.data(), rows.size(), pool));
+  return arrow::Table::FromRecordBatches({rec});
+}
+
+// 64K rows keeps each task's builders (roughly 1.5MB for a few costs per row)
+// close to the size of a per-core L2 cache
+constexpr int64_t kDefaultRowsPerBatch = 1 << 16;
+
+// Same as vector_to_columnar, but splits the rows into ranges of rows_per_batch
+// and builds each range's record batch on the CPU thread pool with its own
+// builders. The batches become the chunks of the table, in the original order.
+inline arrow::Result<std::shared_ptr<arrow::Table>> vector_to_columnar_parallel(
+    const std::vector<data_row>& rows, int64_t rows_per_batch = kDefaultRowsPerBatch,
+    arrow::MemoryPool* pool = arrow::default_memory_pool()) {
+  if (rows_per_batch <= 0) {
+    return arrow::Status::Invalid("rows_per_batch must be positive");
+  }
+
+  const int64_t nrows = static_cast<int64_t>(rows.size());
+  const int64_t nbatches = (nrows + rows_per_batch - 1) / rows_per_batch;
+  // each task only writes its own slot, so no locking is needed
+  arrow::RecordBatchVector batches(nbatches);
+  ARROW_RETURN_NOT_OK(arrow::internal::ParallelFor(
+      static_cast<int>(nbatches), [&](int i) -> arrow::Status {
+        const int64_t offset = i * rows_per_batch;
+        const int64_t length = std::min(rows_per_batch, nrows - offset);
+        ARROW_ASSIGN_OR_RAISE(batches[i],
+                              build_data_row_batch(rows.data() + offset, length, pool));
+        return arrow::Status::OK();
+      }));
+
+  return arrow::Table::FromRecordBatches(data_row_schema(), std::move(batches));
+}
+
+// A non-owning view of one row of a data_row table. The component costs point
+// straight into the list's child buffer, so the view is only valid as long as
+// the table it came from is alive. Null ids and component counts read as 0 and
+// a null list of costs reads as an empty span.
+struct data_row_view {
+  int64_t id;
+  int64_t components;
+  std::span<const double> component_cost;
+};
+
+// Iterates every row of a data_row table as data_row_view, across all of its
+// chunks, without allocating per row. The chunks of the three columns don't need
+// to line up: TableBatchReader slices them (zero-copy) into aligned batches and
+// we keep the raw pointers for each one, adjusted for the slice offsets.
+class data_row_view_range {
+  // raw pointers for one aligned batch of the table
+  struct chunk {
+    int64_t length;
+    const int64_t* ids;
+    const int64_t* comps;
+    const int32_t* offsets;
+    const double* values;
+    // validity bitmaps and their bit offsets, nullptr when a column has no nulls
+    const uint8_t* ids_valid;
+    const uint8_t* comps_valid;
+    const uint8_t* costs_valid;
+    int64_t ids_bit_offset;
+    int64_t comps_bit_offset;
+    int64_t costs_bit_offset;
+  };
+
+  static const uint8_t* validity_of(const arrow::Array& array) {
+    return array.null_count() > 0 ? array.null_bitmap_data() : nullptr;
+  }
+
+  static bool is_valid(const uint8_t* bitmap, int64_t bit_offset, int64_t i) {
+    return bitmap == nullptr || arrow::bit_util::GetBit(bitmap, bit_offset + i);
+  }
+
+ public:
+  static arrow::Result<data_row_view_range> Make(std::shared_ptr<arrow::Table> table) {
+    if (!data_row_schema()->Equals(*table->schema())) {
+      return arrow::Status::Invalid("Schemas do not match!");
+    }
+
+    data_row_view_range range;
+    arrow::TableBatchReader reader{*table};
+    std::shared_ptr<arrow::RecordBatch> batch;
+    while (true) {
+      ARROW_RETURN_NOT_OK(reader.ReadNext(&batch));
+      if (!batch) {
+        break;
+      }
+      if (batch->num_rows() == 0) {
+        continue;
+      }
+      auto ids = std::static_pointer_cast<arrow::Int64Array>(batch->column(0));
+      auto comps = std::static_pointer_cast<arrow::Int64Array>(batch->column(1));
+      auto comp_cost = std::static_pointer_cast<arrow::ListArray>(batch->column(2));
+      auto comp_cost_values =
+          std::static_pointer_cast<arrow::DoubleArray>(comp_cost->values());
+      // raw_values and raw_value_offsets already account for the array offsets,
+      // the list offsets are relative to the (possibly sliced) child array
+      range.chunks_.push_back({batch->num_rows(), ids->raw_values(),
+                               comps->raw_values(), comp_cost->raw_value_offsets(),
+                               comp_cost_values->raw_values(), validity_of(*ids),
+                               validity_of(*comps), validity_of(*comp_cost),
+                               ids->offset(), comps->offset(), comp_cost->offset()});
+    }
+    range.table_ = std::move(table);
+    return range;
+  }
+
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = data_row_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = data_row_view;
+
+    iterator() = default;
+
+    data_row_view operator*() const {
+      const chunk& c = (*chunks_)[chunk_];
+      data_row_view view{0, 0, {}};
+      if (is_valid(c.ids_valid, c.ids_bit_offset, row_)) view.id = c.ids[row_];
+      if (is_valid(c.comps_valid, c.comps_bit_offset, row_)) {
+        view.components = c.comps[row_];
+      }
+      // a null list may still have a non-empty range in the offsets
+      if (is_valid(c.costs_valid, c.costs_bit_offset, row_)) {
+        view.component_cost = {c.values + c.offsets[row_],
+                               c.values + c.offsets[row_ + 1]};
+      }
+      return view;
+    }
+
+    iterator& operator++() {
+      if (++row_ == (*chunks_)[chunk_].length) {
+        ++chunk_;
+        row_ = 0;
+      }
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    bool operator==(const iterator& other) const {
+      return chunk_ == other.chunk_ && row_ == other.row_;
+    }
+    bool operator!=(const iterator& other) const { return !(*this == other); }
+
+   private:
+    friend class data_row_view_range;
+    iterator(const std::vector<chunk>* chunks, size_t chunk)
+        : chunks_(chunks), chunk_(chunk) {}
+
+    const std::vector<chunk>* chunks_ = nullptr;
+    size_t chunk_ = 0;
+    int64_t row_ = 0;
+  };
+
+  iterator begin() const { return iterator(&chunks_, 0); }
+  iterator end() const { return iterator(&chunks_, chunks_.size()); }
+  int64_t size() const { return table_ ? table_->num_rows() : 0; }
+
+ private:
+  std::shared_ptr<arrow::Table> table_;
+  std::vector<chunk> chunks_;
+};
+
+inline arrow::Result<std::vector<data_row>> columnar_to_vector(
+    const std::shared_ptr<arrow::Table>& table) {
+  if (!data_row_schema()->Equals(*table->schema())) {
+    return arrow::Status::Invalid("Schemas do not match!");
+  }
+
+  // fill the rows a column at a time so each column's validity bitmap can be
+  // scanned a word at a time: whole runs of valid values are copied without
+  // any per-row checks and null rows are left as 0 or an empty vector
+  std::vector<data_row> rows(table->num_rows());
+  data_row* out = rows.data();
+  arrow::TableBatchReader reader{*table};
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while (true) {
+    ARROW_RETURN_NOT_OK(reader.ReadNext(&batch));
+    if (!batch) {
+      break;
+    }
+    auto ids = std::static_pointer_cast<arrow::Int64Array>(batch->column(0));
+    auto comps = std::static_pointer_cast<arrow::Int64Array>(batch->column(1));
+    auto comp_cost = std::static_pointer_cast<arrow::ListArray>(batch->column(2));
+    const int64_t* id_values = ids->raw_values();
+    const int64_t* comp_values = comps->raw_values();
+    const int32_t* offsets = comp_cost->raw_value_offsets();
+    const double* costs =
+        std::static_pointer_cast<arrow::DoubleArray>(comp_cost->values())->raw_values();
+
+    // go through the batch in tiles so the rows are still in cache when the
+    // next column is filled in
+    constexpr int64_t kTileRows = 4096;
+    for (int64_t tile = 0; tile < batch->num_rows(); tile += kTileRows) {
+      const int64_t tile_rows = std::min(kTileRows, batch->num_rows() - tile);
+      visit_valid_runs(*ids, tile, tile_rows, [&](int64_t start, int64_t length) {
+        for (int64_t i = start; i < start + length; ++i) out[i].id = id_values[i];
+      });
+      visit_valid_runs(*comps, tile, tile_rows, [&](int64_t start, int64_t length) {
+        for (int64_t i = start; i < start + length; ++i) {
+          out[i].components = comp_values[i];
+        }
+      });
+      visit_valid_runs(*comp_cost, tile, tile_rows, [&](int64_t start, int64_t length) {
+        for (int64_t i = start; i < start + length; ++i) {
+          out[i].component_cost.assign(costs + offsets[i], costs + offsets[i + 1]);
+        }
+      });
+    }
+    out += batch->num_rows();
+  }
+
+  return rows;
+}
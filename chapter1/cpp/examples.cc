@@ -31,6 +31,11 @@
 #include <random>
 #include <vector>
 
+#include "data_row.h"
+#include "random_columns.h"
+#include "struct_append.h"
+#include "vector_buffer.h"
+
 #define ABORT_NOT_OK(expr)                                          \
   do {                                                              \
     auto _res = (expr);                                             \
@@ -44,36 +49,28 @@ void first_example() {
   std::vector<int64_t> data{1, 2, 3, 4};
   auto arr = std::make_shared<arrow::Int64Array>(data.size(), arrow::Buffer::Wrap(data));
   std::cout << arr->ToString() << std::endl;
+
+  // Wrap leaves it up to us to keep `data` alive for as long as the array is
+  // used. Moving the vector in instead hands its memory over to the array,
+  // still without copying anything.
+  std::vector<int64_t> owned{5, 6, 7, 8};
+  auto adopted = MakeArrayFromVector(std::move(owned));
+  std::cout << adopted->ToString() << std::endl;
 }
 
 void random_data_example() {
-  std::random_device rd;
-  std::mt19937 gen{rd()};
-  std::normal_distribution<> d{5, 2};
-
-  auto pool = arrow::default_memory_pool();
-  arrow::DoubleBuilder builder{arrow::float64(), pool};
-
-  constexpr auto ncols = 16;
-  constexpr auto nrows = 8192;
-  arrow::ArrayVector columns(ncols);
-  arrow::FieldVector fields;
-  for (int i = 0; i < ncols; ++i) {
-    for (int j = 0; j < nrows; ++j) {
-      ABORT_NOT_OK(builder.Append(d(gen)));
-    }
-    auto status = builder.Finish(&columns[i]);
-    if (!status.ok()) {
-      std::cerr << status.message() << std::endl;
-      // do something!
-      return;
-    }
-    fields.push_back(arrow::field("c" + std::to_string(i), arrow::float64()));
+  // 16 columns of 8192 normally distributed doubles (mean 5, stddev 2), filled
+  // straight into preallocated buffers, one column per task
+  random_column_options opts;
+  opts.seed = std::random_device{}();
+
+  auto rb = random_record_batch(16, 8192, opts);
+  if (!rb.ok()) {
+    std::cerr << rb.status().message() << std::endl;
+    // do something!
+    return;
   }
-
-  auto rb =
-      arrow::RecordBatch::Make(arrow::schema(fields), columns[0]->length(), columns);
-  std::cout << rb->ToString() << std::endl;
+  std::cout << (*rb)->ToString() << std::endl;
 }
 
 void building_struct_array() {
@@ -138,88 +135,31 @@ void build_struct_builder() {
   std::cout << out->ToString() << std::endl;
 }
 
-struct data_row {
-  int64_t id;
-  int64_t components;
-  std::vector<double> component_cost;
-};
-
-arrow::Result<std::shared_ptr<arrow::Table>> vector_to_columnar(
-    const std::vector<data_row>& rows) {
-  using arrow::DoubleBuilder;
-  using arrow::Int64Builder;
-  using arrow::ListBuilder;
-  using arrow::RecordBatchBuilder;
-
-  // the builders are more efficient since they use the memory pools
-  arrow::MemoryPool* pool = arrow::default_memory_pool();
-
-  auto schema = arrow::schema(
-      {arrow::field("id", arrow::int64()), arrow::field("components", arrow::int64()),
-       arrow::field("component_cost", arrow::list(arrow::float64()))});
-
-  ARROW_ASSIGN_OR_RAISE(auto record_bldr, RecordBatchBuilder::Make(schema, pool));
-  auto id_bldr = record_bldr->GetFieldAs<Int64Builder>(0);
-  auto comp_bldr = record_bldr->GetFieldAs<Int64Builder>(1);
-  auto comp_cost_bldr = record_bldr->GetFieldAs<ListBuilder>(2);
-  auto comp_item_cost_bldr =
-      (static_cast<DoubleBuilder*>(comp_cost_bldr->value_builder()));
-
-  // just loop over existing data and insert it, check return values in case
-  // we can't allocate enough additional memory
-  for (const auto& row : rows) {
-    ARROW_RETURN_NOT_OK(id_bldr->Append(row.id));
-    ARROW_RETURN_NOT_OK(comp_bldr->Append(row.components));
-
-    // start a new list
-    ARROW_RETURN_NOT_OK(comp_cost_bldr->Append());
-    // add actual values
-    ARROW_RETURN_NOT_OK(comp_item_cost_bldr->AppendValues(row.component_cost.data(),
-                                                          row.component_cost.size()));
-  }
-
-  ARROW_ASSIGN_OR_RAISE(auto rec, record_bldr->Flush());
-  return arrow::Table::FromRecordBatches({rec});
-}
-
-arrow::Result<std::vector<data_row>> columnar_to_vector(
-    const std::shared_ptr<arrow::Table>& table) {
-  // first check the table conforms to our expected schema, then we can
-  // build up the vector of rows incrementally
-  auto expected_schema = arrow::schema(
-      {arrow::field("id", arrow::int64()), arrow::field("components", arrow::int64()),
-       arrow::field("component_cost", arrow::list(arrow::float64()))});
+void build_struct_builder_bulk() {
+  using arrow::field;
+  std::shared_ptr<arrow::DataType> st_type =
+      arrow::struct_({field("archer", arrow::utf8()), field("location", arrow::utf8()),
+                      field("year", arrow::int16())});
 
-  if (!expected_schema->Equals(*table->schema())) {
-    return arrow::Status::Invalid("Schemas do not match!");
-  }
+  std::unique_ptr<arrow::ArrayBuilder> tmp;
+  ABORT_NOT_OK(arrow::MakeBuilder(arrow::default_memory_pool(), st_type, &tmp));
+  std::shared_ptr<arrow::StructBuilder> builder;
+  builder.reset(static_cast<arrow::StructBuilder*>(tmp.release()));
 
-  // now we can just unpack everything
-  auto ids = std::static_pointer_cast<arrow::Int64Array>(table->column(0)->chunk(0));
-  auto comps = std::static_pointer_cast<arrow::Int64Array>(table->column(1)->chunk(0));
-  auto comp_cost = std::static_pointer_cast<arrow::ListArray>(table->column(2)->chunk(0));
-  auto comp_cost_values =
-      std::static_pointer_cast<arrow::DoubleArray>(comp_cost->values());
+  std::vector<std::string> archers{"Legolas", "Oliver", "Merida", "Lara", "Artemis"};
+  std::vector<std::string> locations{"Murkwood", "Star City", "Scotland", "London",
+                                     "Greece"};
+  std::vector<int16_t> years{1954, 1941, 2012, 1996, -600};
 
-  // to enable zero-copy slices, we would need to account for the slicing offset. Since
-  // we're going to use the native raw values pointer, we have to handle this ourselves.
-  // If we were just using Value(...), then it would already account for offsets
-  // internally. for this example, we're assuming an offset of 0.
-  const double* ccv_ptr = comp_cost_values->raw_values();
-  std::vector<data_row> rows;
-  for (int64_t i = 0; i < table->num_rows(); i++) {
-    // we're also going to assume there are no nulls in this table for this example
-    // otherwise we'd need to also check IsValid/IsNull or optimize by leveraging
-    // the validity bitmap.
-    int64_t id = ids->Value(i);
-    int64_t comp_val = comps->Value(i);
-    const double* first = ccv_ptr + comp_cost->value_offset(i);
-    const double* last = ccv_ptr + comp_cost->value_offset(i + 1);
-    std::vector<double> comp_vec(first, last);
-    rows.push_back({id, comp_val, comp_vec});
-  }
+  // one call appends all of the structs and each child column in bulk, the
+  // bitmap marks the 4th struct (Lara) as null
+  const uint8_t validity = 0b10111;
+  ABORT_NOT_OK(append_struct_columns(builder.get(), archers.size(), &validity, 0,
+                                     archers, locations, years));
 
-  return rows;
+  std::shared_ptr<arrow::Array> out;
+  ABORT_NOT_OK(builder->Finish(&out));
+  std::cout << out->ToString() << std::endl;
 }
 
 void run_row_conversions() {
@@ -231,6 +171,9 @@ void run_row_conversions() {
   table = vector_to_columnar(orig).ValueOrDie();
   converted_rows = columnar_to_vector(table).ValueOrDie();
   assert(orig.size() == converted_rows.size());
+  // the compile-time converter from row_converter.h builds the same table
+  // by writing the buffers directly instead of using the builders
+  assert(rows_to_table(orig).ValueOrDie()->Equals(*table));
 
   // Print out contents of table, should get
   // ID Components Component prices
@@ -255,5 +198,6 @@ int main(int argc, char** argv) {
   random_data_example();
   building_struct_array();
   build_struct_builder();
+  build_struct_builder_bulk();
   run_row_conversions();
 }
\ No newline at end of file
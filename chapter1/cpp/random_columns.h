@@ -0,0 +1,286 @@
+// MIT License
+//
+// Copyright (c) 2024 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <arrow/util/bit_util.h>
+#include <arrow/util/parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Fills float64 columns with random values by writing straight into
+// preallocated (64-byte aligned) buffers instead of going through a builder.
+// Each column gets its own xoshiro256** engine, jumped 2^128 steps from the
+// previous one so the streams never overlap, and columns are generated in
+// parallel on the CPU thread pool.
+
+enum class random_distribution { normal, uniform, zipf };
+
+struct random_column_options {
+  random_distribution distribution = random_distribution::normal;
+  // normal
+  double mean = 5;
+  double stddev = 2;
+  // uniform, over [low, high)
+  double low = 0;
+  double high = 1;
+  // zipf, ranks in [1, zipf_n] with exponent zipf_s, stored as doubles
+  int64_t zipf_n = 1000;
+  double zipf_s = 1.1;
+  // probability of each value being null, 0 means no validity bitmap at all
+  double null_probability = 0;
+  uint64_t seed = 42;
+};
+
+namespace random_columns_detail {
+
+// xoshiro256** by Blackman and Vigna, much cheaper per draw than std::mt19937
+class xoshiro256 {
+ public:
+  explicit xoshiro256(uint64_t seed) {
+    // splitmix64 to spread the seed over the whole state
+    for (auto& word : s_) {
+      seed += 0x9e3779b97f4a7c15ULL;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  uint64_t operator()() {
+    const uint64_t result = rotl(s_[1] * 5, 7) * 9;
+    const uint64_t t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = rotl(s_[3], 45);
+    return result;
+  }
+
+  // uniform in [0, 1) from the top 53 bits
+  double next_double() { return static_cast<double>((*this)() >> 11) * 0x1.0p-53; }
+
+  // equivalent to 2^128 calls, used to hand out non-overlapping streams
+  void jump() {
+    static constexpr uint64_t kJump[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+                                         0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+    uint64_t s[4] = {0, 0, 0, 0};
+    for (uint64_t word : kJump) {
+      for (int b = 0; b < 64; ++b) {
+        if (word & (uint64_t{1} << b)) {
+          for (int k = 0; k < 4; ++k) s[k] ^= s_[k];
+        }
+        (*this)();
+      }
+    }
+    for (int k = 0; k < 4; ++k) s_[k] = s[k];
+  }
+
+ private:
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+  uint64_t s_[4];
+};
+
+// Rejection-inversion sampling (Hoermann and Derflinger), constant time per
+// draw regardless of zipf_n and without a precomputed table.
+class zipf_sampler {
+ public:
+  zipf_sampler(int64_t n, double s)
+      : n_(n),
+        s_(s),
+        h_integral_x1_(h_integral(1.5) - 1),
+        h_integral_n_(h_integral(n + 0.5)),
+        threshold_(2 - h_integral_inverse(h_integral(2.5) - h(2))) {}
+
+  int64_t operator()(xoshiro256& gen) const {
+    while (true) {
+      double u = h_integral_n_ + gen.next_double() * (h_integral_x1_ - h_integral_n_);
+      double x = h_integral_inverse(u);
+      int64_t k = static_cast<int64_t>(x + 0.5);
+      k = k < 1 ? 1 : (k > n_ ? n_ : k);
+      if (k - x <= threshold_ || u >= h_integral(k + 0.5) - h(k)) {
+        return k;
+      }
+    }
+  }
+
+ private:
+  // log1p(x) / x and expm1(x) / x, with series expansions near zero
+  static double helper1(double x) {
+    return std::abs(x) > 1e-8 ? std::log1p(x) / x
+                              : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+  }
+  static double helper2(double x) {
+    return std::abs(x) > 1e-8 ? std::expm1(x) / x
+                              : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+  }
+  double h(double x) const { return std::exp(-s_ * std::log(x)); }
+  double h_integral(double x) const {
+    double log_x = std::log(x);
+    return helper2((1 - s_) * log_x) * log_x;
+  }
+  double h_integral_inverse(double x) const {
+    double t = x * (1 - s_);
+    if (t < -1) t = -1;  // guard against rounding errors
+    return std::exp(helper1(t) * x);
+  }
+
+  int64_t n_;
+  double s_;
+  double h_integral_x1_;
+  double h_integral_n_;
+  double threshold_;
+};
+
+inline arrow::Status fill_values(const random_column_options& opts, xoshiro256& gen,
+                                 double* out, int64_t length) {
+  switch (opts.distribution) {
+    case random_distribution::normal: {
+      // Marsaglia's polar method, two values per accepted pair of draws and no
+      // trigonometric calls
+      for (int64_t i = 0; i < length;) {
+        double u = 2 * gen.next_double() - 1;
+        double v = 2 * gen.next_double() - 1;
+        double r2 = u * u + v * v;
+        if (r2 >= 1 || r2 == 0) {
+          continue;
+        }
+        double scale = std::sqrt(-2 * std::log(r2) / r2) * opts.stddev;
+        out[i++] = opts.mean + u * scale;
+        if (i < length) {
+          out[i++] = opts.mean + v * scale;
+        }
+      }
+      return arrow::Status::OK();
+    }
+    case random_distribution::uniform: {
+      const double scale = opts.high - opts.low;
+      for (int64_t i = 0; i < length; ++i) {
+        out[i] = opts.low + scale * gen.next_double();
+      }
+      return arrow::Status::OK();
+    }
+    case random_distribution::zipf: {
+      if (opts.zipf_n < 1 || opts.zipf_s <= 0) {
+        return arrow::Status::Invalid("zipf needs zipf_n >= 1 and zipf_s > 0");
+      }
+      zipf_sampler zipf{opts.zipf_n, opts.zipf_s};
+      for (int64_t i = 0; i < length; ++i) {
+        out[i] = static_cast<double>(zipf(gen));
+      }
+      return arrow::Status::OK();
+    }
+  }
+  return arrow::Status::Invalid("unknown distribution");
+}
+
+// builds the validity bitmap a word at a time and returns the null count
+inline int64_t fill_validity(double null_probability, xoshiro256& gen, uint8_t* bitmap,
+                             int64_t length) {
+  if (null_probability >= 1) {
+    std::memset(bitmap, 0, arrow::bit_util::BytesForBits(length));
+    return length;
+  }
+  // compare raw 64-bit draws against a fixed threshold rather than converting
+  // every draw to a double
+  const uint64_t threshold = static_cast<uint64_t>(null_probability * 0x1.0p64);
+  int64_t null_count = 0;
+  for (int64_t i = 0; i < length; i += 64) {
+    const int64_t nbits = std::min<int64_t>(64, length - i);
+    uint64_t word = 0;
+    for (int64_t b = 0; b < nbits; ++b) {
+      word |= static_cast<uint64_t>(gen() >= threshold) << b;
+    }
+    null_count += nbits - __builtin_popcountll(word);
+    // bitmaps are LSB first, which matches the byte order of the word on
+    // little-endian machines
+    std::memcpy(bitmap + i / 8, &word, arrow::bit_util::BytesForBits(nbits));
+  }
+  return null_count;
+}
+
+}  // namespace random_columns_detail
+
+// Generates one float64 column from the given engine.
+inline arrow::Result<std::shared_ptr<arrow::Array>> random_double_column(
+    int64_t length, const random_column_options& opts,
+    random_columns_detail::xoshiro256& gen,
+    arrow::MemoryPool* pool = arrow::default_memory_pool()) {
+  if (opts.null_probability < 0 || opts.null_probability > 1) {
+    return arrow::Status::Invalid("null_probability must be within [0, 1]");
+  }
+
+  ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> values,
+                        arrow::AllocateBuffer(length * sizeof(double), pool));
+  ARROW_RETURN_NOT_OK(random_columns_detail::fill_values(
+      opts, gen, reinterpret_cast<double*>(values->mutable_data()), length));
+
+  std::shared_ptr<arrow::Buffer> validity;
+  int64_t null_count = 0;
+  if (opts.null_probability > 0) {
+    ARROW_ASSIGN_OR_RAISE(validity, arrow::AllocateBitmap(length, pool));
+    null_count = random_columns_detail::fill_validity(
+        opts.null_probability, gen, validity->mutable_data(), length);
+  }
+
+  return arrow::MakeArray(arrow::ArrayData::Make(
+      arrow::float64(), length, {std::move(validity), std::move(values)}, null_count));
+}
+
+// Generates ncols float64 columns named c0, c1, ... with one column per task
+// on the CPU thread pool. The output only depends on opts.seed, not on how
+// the columns end up scheduled.
+inline arrow::Result<std::shared_ptr<arrow::RecordBatch>> random_record_batch(
+    int ncols, int64_t nrows, const random_column_options& opts,
+    arrow::MemoryPool* pool = arrow::default_memory_pool()) {
+  std::vector<random_columns_detail::xoshiro256> engines;
+  engines.reserve(ncols);
+  random_columns_detail::xoshiro256 gen{opts.seed};
+  for (int i = 0; i < ncols; ++i) {
+    engines.push_back(gen);
+    gen.jump();
+  }
+
+  arrow::ArrayVector columns(ncols);
+  ARROW_RETURN_NOT_OK(arrow::internal::ParallelFor(ncols, [&](int i) -> arrow::Status {
+    ARROW_ASSIGN_OR_RAISE(columns[i],
+                          random_double_column(nrows, opts, engines[i], pool));
+    return arrow::Status::OK();
+  }));
+
+  arrow::FieldVector fields;
+  for (int i = 0; i < ncols; ++i) {
+    fields.push_back(arrow::field("c" + std::to_string(i), arrow::float64()));
+  }
+  return arrow::RecordBatch::Make(arrow::schema(std::move(fields)), nrows,
+                                  std::move(columns));
+}
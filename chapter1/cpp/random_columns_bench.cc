@@ -0,0 +1,84 @@
+// MIT License
+//
+// Copyright (c) 2024 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <arrow/api.h>
+#include <arrow/util/logging.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "random_columns.h"
+
+// Measures values/sec for the DoubleBuilder loop from random_data_example
+// against random_record_batch for each distribution, with and without nulls.
+// Usage: random_columns_bench [nrows [ncols]], defaults to 16 columns of 1M rows.
+
+template <typename Fn>
+void report(const char* label, int64_t nvalues, Fn&& fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << label << ": " << elapsed.count() << " s, "
+            << static_cast<double>(nvalues) / elapsed.count() / 1e6 << " M values/s"
+            << std::endl;
+}
+
+int main(int argc, char** argv) {
+  int64_t nrows = argc > 1 ? std::atoll(argv[1]) : 1 << 20;
+  int ncols = argc > 2 ? std::atoi(argv[2]) : 16;
+  const int64_t nvalues = nrows * ncols;
+  std::cout << "rows: " << nrows << ", columns: " << ncols << std::endl;
+
+  report("builder loop (normal)", nvalues, [&] {
+    std::mt19937 gen{42};
+    std::normal_distribution<> d{5, 2};
+    arrow::DoubleBuilder builder;
+    arrow::ArrayVector columns(ncols);
+    for (int i = 0; i < ncols; ++i) {
+      for (int64_t j = 0; j < nrows; ++j) {
+        ARROW_CHECK_OK(builder.Append(d(gen)));
+      }
+      ARROW_CHECK_OK(builder.Finish(&columns[i]));
+    }
+  });
+
+  const std::pair<const char*, random_distribution> distributions[] = {
+      {"normal", random_distribution::normal},
+      {"uniform", random_distribution::uniform},
+      {"zipf", random_distribution::zipf}};
+  for (const auto& [name, distribution] : distributions) {
+    for (double null_probability : {0.0, 0.1}) {
+      random_column_options opts;
+      opts.distribution = distribution;
+      opts.null_probability = null_probability;
+      std::ostringstream label;
+      label << "random_record_batch (" << name << ", nulls=" << null_probability << ")";
+      report(label.str().c_str(), nvalues, [&] {
+        auto batch = random_record_batch(ncols, nrows, opts).ValueOrDie();
+        ARROW_CHECK_EQ(batch->num_rows(), nrows);
+      });
+    }
+  }
+}
@@ -0,0 +1,105 @@
+// MIT License
+//
+// Copyright (c) 2024 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <arrow/api.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "data_row.h"
+
+// Compares the RecordBatchBuilder based vector_to_columnar against the
+// compile-time rows_to_table converter and vector_to_columnar_parallel, and
+// materializing rows with columnar_to_vector against walking them with
+// data_row_view_range. The default sizes are 1M, 10M and 100M rows, the last one
+// needs roughly 10GB of memory for the input rows alone, so pass smaller row
+// counts on the command line if needed.
+
+std::vector<data_row> make_rows(int64_t n) {
+  std::vector<data_row> rows;
+  rows.reserve(n);
+  for (int64_t i = 0; i < n; ++i) {
+    int64_t components = 1 + i % 4;
+    std::vector<double> costs(components);
+    for (int64_t j = 0; j < components; ++j) {
+      costs[j] = static_cast<double>(i + j) * 0.5;
+    }
+    rows.push_back({i, components, std::move(costs)});
+  }
+  return rows;
+}
+
+template <typename Fn>
+void time_rows(const char* label, int64_t nrows, Fn&& fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "  " << label << ": " << elapsed.count() << " s, "
+            << static_cast<double>(nrows) / elapsed.count() / 1e6 << " M rows/s"
+            << std::endl;
+}
+
+template <typename Fn>
+std::shared_ptr<arrow::Table> time_it(const char* label, int64_t nrows, Fn&& fn) {
+  std::shared_ptr<arrow::Table> table;
+  time_rows(label, nrows, [&] { table = fn().ValueOrDie(); });
+  return table;
+}
+
+int main(int argc, char** argv) {
+  std::vector<int64_t> sizes{1'000'000, 10'000'000, 100'000'000};
+  if (argc > 1) {
+    sizes.clear();
+    for (int i = 1; i < argc; ++i) {
+      sizes.push_back(std::atoll(argv[i]));
+    }
+  }
+
+  for (int64_t n : sizes) {
+    std::cout << "N: " << n << std::endl;
+    auto rows = make_rows(n);
+    auto expected =
+        time_it("builders", n, [&] { return vector_to_columnar(rows); });
+    auto actual = time_it("rows_to_table", n, [&] { return rows_to_table(rows); });
+    std::cout << "  equal: " << std::boolalpha << expected->Equals(*actual) << std::endl;
+    auto chunked = time_it("builders (parallel)", n,
+                           [&] { return vector_to_columnar_parallel(rows); });
+    std::cout << "  equal: " << expected->Equals(*chunked) << " ("
+              << chunked->column(0)->num_chunks() << " chunks)" << std::endl;
+
+    // sum the costs both ways so the views can't be optimized out
+    double materialized = 0, viewed = 0;
+    time_rows("columnar_to_vector", n, [&] {
+      for (const auto& row : columnar_to_vector(actual).ValueOrDie()) {
+        for (double cost : row.component_cost) materialized += cost;
+      }
+    });
+    time_rows("data_row_view_range", n, [&] {
+      for (const auto row : data_row_view_range::Make(actual).ValueOrDie()) {
+        for (double cost : row.component_cost) viewed += cost;
+      }
+    });
+    std::cout << "  equal: " << (materialized == viewed) << std::endl;
+  }
+}
@@ -0,0 +1,265 @@
+// MIT License
+//
+// Copyright (c) 2024 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <arrow/type_traits.h>
+
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// A single column of a row struct: the field name and a pointer to the member
+// holding its value. Everything about the conversion is decided from the member
+// type at compile time, so the inner loops are plain stores into the buffers.
+template <typename Row, typename T>
+struct column_desc {
+  using value_type = T;
+  const char* name;
+  T Row::*member;
+};
+
+template <typename Row, typename T>
+constexpr column_desc<Row, T> column(const char* name, T Row::*member) {
+  return {name, member};
+}
+
+// Specialize this for a row struct with a `static constexpr` tuple of columns
+// named `columns`, see data_row.h for an example. Supported member types are
+// arithmetic types and bool, std::optional of those (nullable), std::string
+// and std::vector of arithmetic types (list columns).
+template <typename Row>
+struct row_layout;
+
+namespace row_converter_detail {
+
+template <typename T>
+struct is_optional : std::false_type {};
+template <typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template <typename T>
+struct is_vector : std::false_type {};
+template <typename T, typename A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <typename T>
+std::shared_ptr<arrow::DataType> arrow_type_for() {
+  if constexpr (is_optional<T>::value) {
+    return arrow::CTypeTraits<typename T::value_type>::type_singleton();
+  } else {
+    return arrow::CTypeTraits<T>::type_singleton();
+  }
+}
+
+// packs the result of pred(i) for i in [0, n) into a zero-padded bitmap,
+// a full byte at a time, and returns the number of unset bits
+template <typename Pred>
+int64_t pack_bits(int64_t n, uint8_t* out, Pred&& pred) {
+  int64_t unset = 0;
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint8_t byte = 0;
+    for (int b = 0; b < 8; ++b) {
+      byte |= static_cast<uint8_t>(pred(i + b)) << b;
+    }
+    unset += 8 - __builtin_popcount(byte);
+    *out++ = byte;
+  }
+  if (i < n) {
+    uint8_t byte = 0;
+    for (int b = 0; i + b < n; ++b) {
+      byte |= static_cast<uint8_t>(pred(i + b)) << b;
+    }
+    unset += (n - i) - __builtin_popcount(byte);
+    *out = byte;
+  }
+  return unset;
+}
+
+// computes the int32 offsets for n variable length values and returns the
+// total length, failing up front rather than per row if it would overflow
+template <typename SizeOf>
+arrow::Result<std::shared_ptr<arrow::Buffer>> make_offsets(int64_t n,
+                                                           arrow::MemoryPool* pool,
+                                                           int64_t* total,
+                                                           SizeOf&& size_of) {
+  ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> offsets,
+                        arrow::AllocateBuffer((n + 1) * sizeof(int32_t), pool));
+  auto* out = reinterpret_cast<int32_t*>(offsets->mutable_data());
+  int64_t pos = 0;
+  for (int64_t i = 0; i < n; ++i) {
+    out[i] = static_cast<int32_t>(pos);
+    pos += static_cast<int64_t>(size_of(i));
+  }
+  if (pos > std::numeric_limits<int32_t>::max()) {
+    return arrow::Status::CapacityError("column too large for 32-bit offsets: ", pos);
+  }
+  out[n] = static_cast<int32_t>(pos);
+  *total = pos;
+  return offsets;
+}
+
+template <typename T, typename Get>
+arrow::Result<std::shared_ptr<arrow::Buffer>> write_values(int64_t n,
+                                                           arrow::MemoryPool* pool,
+                                                           Get&& get) {
+  if constexpr (std::is_same_v<T, bool>) {
+    ARROW_ASSIGN_OR_RAISE(auto values, arrow::AllocateBitmap(n, pool));
+    pack_bits(n, values->mutable_data(), get);
+    return values;
+  } else {
+    ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> values,
+                          arrow::AllocateBuffer(n * sizeof(T), pool));
+    T* out = reinterpret_cast<T*>(values->mutable_data());
+    for (int64_t i = 0; i < n; ++i) {
+      out[i] = get(i);
+    }
+    return values;
+  }
+}
+
+template <typename Row, typename T>
+arrow::Result<std::shared_ptr<arrow::ArrayData>> convert_column(const Row* rows,
+                                                                int64_t n,
+                                                                T Row::*member,
+                                                                arrow::MemoryPool* pool) {
+  auto type = arrow_type_for<T>();
+  if constexpr (std::is_arithmetic_v<T>) {
+    auto value = [&](int64_t i) { return rows[i].*member; };
+    ARROW_ASSIGN_OR_RAISE(auto values, write_values<T>(n, pool, value));
+    return arrow::ArrayData::Make(std::move(type), n, {nullptr, std::move(values)}, 0);
+  } else if constexpr (is_optional<T>::value) {
+    using V = typename T::value_type;
+    static_assert(std::is_arithmetic_v<V>,
+                  "only optional arithmetic members are supported");
+    ARROW_ASSIGN_OR_RAISE(auto validity, arrow::AllocateBitmap(n, pool));
+    int64_t null_count = pack_bits(n, validity->mutable_data(), [&](int64_t i) {
+      return (rows[i].*member).has_value();
+    });
+    ARROW_ASSIGN_OR_RAISE(auto values, write_values<V>(n, pool, [&](int64_t i) {
+                            return (rows[i].*member).value_or(V{});
+                          }));
+    if (null_count == 0) {
+      validity = nullptr;
+    }
+    return arrow::ArrayData::Make(std::move(type), n,
+                                  {std::move(validity), std::move(values)}, null_count);
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    int64_t total = 0;
+    ARROW_ASSIGN_OR_RAISE(auto offsets, make_offsets(n, pool, &total, [&](int64_t i) {
+                            return (rows[i].*member).size();
+                          }));
+    ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> data,
+                          arrow::AllocateBuffer(total, pool));
+    uint8_t* out = data->mutable_data();
+    for (int64_t i = 0; i < n; ++i) {
+      const std::string& s = rows[i].*member;
+      std::memcpy(out, s.data(), s.size());
+      out += s.size();
+    }
+    return arrow::ArrayData::Make(std::move(type), n,
+                                  {nullptr, std::move(offsets), std::move(data)}, 0);
+  } else if constexpr (is_vector<T>::value) {
+    using V = typename T::value_type;
+    static_assert(std::is_arithmetic_v<V> && !std::is_same_v<V, bool>,
+                  "only vectors of numeric values are supported");
+    int64_t total = 0;
+    ARROW_ASSIGN_OR_RAISE(auto offsets, make_offsets(n, pool, &total, [&](int64_t i) {
+                            return (rows[i].*member).size();
+                          }));
+    ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> values,
+                          arrow::AllocateBuffer(total * sizeof(V), pool));
+    V* out = reinterpret_cast<V*>(values->mutable_data());
+    for (int64_t i = 0; i < n; ++i) {
+      const T& v = rows[i].*member;
+      if (!v.empty()) {
+        std::memcpy(out, v.data(), v.size() * sizeof(V));
+      }
+      out += v.size();
+    }
+    auto child = arrow::ArrayData::Make(arrow_type_for<V>(), total,
+                                        {nullptr, std::move(values)}, 0);
+    return arrow::ArrayData::Make(std::move(type), n, {nullptr, std::move(offsets)},
+                                  {std::move(child)}, 0);
+  } else {
+    static_assert(!sizeof(T*), "unsupported member type in row_layout");
+  }
+}
+
+}  // namespace row_converter_detail
+
+template <typename Row>
+std::shared_ptr<arrow::Schema> row_schema() {
+  arrow::FieldVector fields;
+  std::apply(
+      [&](const auto&... col) {
+        (fields.push_back(arrow::field(
+             col.name, row_converter_detail::arrow_type_for<
+                           typename std::decay_t<decltype(col)>::value_type>())),
+         ...);
+      },
+      row_layout<Row>::columns);
+  return arrow::schema(std::move(fields));
+}
+
+// Converts n rows into a record batch by filling each column's buffers
+// directly. Sizes are known before anything is written, so the only
+// failure points are the allocations and the 32-bit offset limit.
+template <typename Row>
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> rows_to_record_batch(
+    const Row* rows, int64_t n, arrow::MemoryPool* pool = arrow::default_memory_pool()) {
+  arrow::ArrayDataVector columns;
+  arrow::Status status;
+  std::apply(
+      [&](const auto&... col) {
+        (... && [&] {
+          auto maybe_column =
+              row_converter_detail::convert_column(rows, n, col.member, pool);
+          if (!maybe_column.ok()) {
+            status = maybe_column.status();
+            return false;
+          }
+          columns.push_back(maybe_column.MoveValueUnsafe());
+          return true;
+        }());
+      },
+      row_layout<Row>::columns);
+  ARROW_RETURN_NOT_OK(status);
+  return arrow::RecordBatch::Make(row_schema<Row>(), n, std::move(columns));
+}
+
+template <typename Row>
+arrow::Result<std::shared_ptr<arrow::Table>> rows_to_table(
+    const std::vector<Row>& rows,
+    arrow::MemoryPool* pool = arrow::default_memory_pool()) {
+  ARROW_ASSIGN_OR_RAISE(
+      auto batch,
+      rows_to_record_batch(rows.data(), static_cast<int64_t>(rows.size()), pool));
+  return arrow::Table::FromRecordBatches({std::move(batch)});
+}
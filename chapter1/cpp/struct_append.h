@@ -0,0 +1,148 @@
+// MIT License
+//
+// Copyright (c) 2024 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <arrow/type_traits.h>
+#include <arrow/util/bit_util.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Appends `length` struct values to a StructBuilder from one span of values per
+// child field, instead of calling Append on the struct and every child for each
+// row. Each child gets a single bulk append after one type check and one
+// reservation, so the cost per row is the same as building flat columns.
+//
+// The spans must be in field order and hold at least `length` values: numeric
+// children take std::span<const T> for the matching C type, string children
+// take std::span<const std::string> or std::span<const std::string_view>. The
+// struct-level validity bitmap (nullptr when all are valid) marks entire
+// structs as null, the children still get a value for those slots as the
+// format requires. All spans are checked and all children reserved before
+// anything is appended, so on an error the builder is left as it was.
+
+namespace struct_append_detail {
+
+template <typename T>
+constexpr bool is_string_value =
+    std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>;
+
+// checks the span length and the child type and reserves the child's memory,
+// so the append that follows can't fail half way through
+template <typename T>
+arrow::Status prepare_child(arrow::ArrayBuilder* child, std::span<const T> values,
+                            int64_t length) {
+  if (static_cast<int64_t>(values.size()) < length) {
+    return arrow::Status::Invalid("child column has ", values.size(),
+                                  " values, expected at least ", length);
+  }
+
+  if constexpr (is_string_value<T>) {
+    if (child->type()->id() != arrow::Type::STRING) {
+      return arrow::Status::TypeError("expected a utf8 child, got ",
+                                      child->type()->ToString());
+    }
+    auto* builder = static_cast<arrow::StringBuilder*>(child);
+    int64_t total = 0;
+    for (int64_t i = 0; i < length; ++i) total += values[i].size();
+    ARROW_RETURN_NOT_OK(builder->Reserve(length));
+    return builder->ReserveData(total);
+  } else {
+    static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>,
+                  "only numeric and string children are supported");
+    using ArrowType = typename arrow::CTypeTraits<T>::ArrowType;
+    if (child->type()->id() != ArrowType::type_id) {
+      return arrow::Status::TypeError("expected a ", ArrowType::type_name(),
+                                      " child, got ", child->type()->ToString());
+    }
+    return child->Reserve(length);
+  }
+}
+
+// only called after prepare_child succeeded for every child
+template <typename T>
+arrow::Status append_child(arrow::ArrayBuilder* child, std::span<const T> values,
+                           int64_t length) {
+  if constexpr (is_string_value<T>) {
+    auto* builder = static_cast<arrow::StringBuilder*>(child);
+    for (int64_t i = 0; i < length; ++i) {
+      builder->UnsafeAppend(std::string_view{values[i]});
+    }
+    return arrow::Status::OK();
+  } else {
+    using ArrowType = typename arrow::CTypeTraits<T>::ArrowType;
+    return static_cast<arrow::NumericBuilder<ArrowType>*>(child)->AppendValues(
+        values.data(), length);
+  }
+}
+
+}  // namespace struct_append_detail
+
+template <typename... Columns>
+arrow::Status append_struct_columns(arrow::StructBuilder* builder, int64_t length,
+                                    const uint8_t* validity, int64_t validity_offset,
+                                    const Columns&... columns) {
+  if (builder->num_fields() != static_cast<int>(sizeof...(Columns))) {
+    return arrow::Status::Invalid("struct has ", builder->num_fields(),
+                                  " fields but ", sizeof...(Columns),
+                                  " columns were given");
+  }
+
+  int i = 0;
+  arrow::Status status;
+  ((status.ok() ? (status = struct_append_detail::prepare_child(
+                       builder->field_builder(i++), std::span{columns}, length))
+                : status),
+   ...);
+  ARROW_RETURN_NOT_OK(status);
+  ARROW_RETURN_NOT_OK(builder->Reserve(length));
+
+  // StructBuilder only takes validity as bytes, so expand the bitmap through a
+  // small buffer rather than appending the structs one at a time
+  if (validity == nullptr) {
+    ARROW_RETURN_NOT_OK(builder->AppendValues(length, nullptr));
+  } else {
+    constexpr int64_t kChunk = 4096;
+    uint8_t valid_bytes[kChunk];
+    for (int64_t start = 0; start < length; start += kChunk) {
+      const int64_t n = std::min(kChunk, length - start);
+      for (int64_t i = 0; i < n; ++i) {
+        valid_bytes[i] = arrow::bit_util::GetBit(validity, validity_offset + start + i);
+      }
+      ARROW_RETURN_NOT_OK(builder->AppendValues(n, valid_bytes));
+    }
+  }
+
+  i = 0;
+  ((status.ok() ? (status = struct_append_detail::append_child(
+                       builder->field_builder(i++), std::span{columns}, length))
+                : status),
+   ...);
+  return status;
+}
@@ -0,0 +1,150 @@
+// MIT License
+//
+// Copyright (c) 2024 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <arrow/api.h>
+#include <arrow/util/logging.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "struct_append.h"
+
+// Builds the same 8 field struct array three ways: appending row by row like
+// build_struct_builder, with append_struct_columns, and as flat columns with
+// one builder per field (the target throughput). Usage: struct_builder_bench
+// [nrows], default 4M.
+
+struct columns {
+  std::vector<std::string> name;
+  std::vector<std::string> city;
+  std::vector<int64_t> a, b, c;
+  std::vector<double> x, y, z;
+};
+
+std::shared_ptr<arrow::DataType> struct_type() {
+  using arrow::field;
+  return arrow::struct_({field("name", arrow::utf8()), field("city", arrow::utf8()),
+                         field("a", arrow::int64()), field("b", arrow::int64()),
+                         field("c", arrow::int64()), field("x", arrow::float64()),
+                         field("y", arrow::float64()), field("z", arrow::float64())});
+}
+
+std::unique_ptr<arrow::StructBuilder> make_builder() {
+  std::unique_ptr<arrow::ArrayBuilder> tmp;
+  ARROW_CHECK_OK(arrow::MakeBuilder(arrow::default_memory_pool(), struct_type(), &tmp));
+  return std::unique_ptr<arrow::StructBuilder>(
+      static_cast<arrow::StructBuilder*>(tmp.release()));
+}
+
+std::shared_ptr<arrow::Array> row_wise(const columns& cols, int64_t n) {
+  auto builder = make_builder();
+  auto name = static_cast<arrow::StringBuilder*>(builder->field_builder(0));
+  auto city = static_cast<arrow::StringBuilder*>(builder->field_builder(1));
+  auto a = static_cast<arrow::Int64Builder*>(builder->field_builder(2));
+  auto b = static_cast<arrow::Int64Builder*>(builder->field_builder(3));
+  auto c = static_cast<arrow::Int64Builder*>(builder->field_builder(4));
+  auto x = static_cast<arrow::DoubleBuilder*>(builder->field_builder(5));
+  auto y = static_cast<arrow::DoubleBuilder*>(builder->field_builder(6));
+  auto z = static_cast<arrow::DoubleBuilder*>(builder->field_builder(7));
+  for (int64_t i = 0; i < n; ++i) {
+    ARROW_CHECK_OK(builder->Append());
+    ARROW_CHECK_OK(name->Append(cols.name[i]));
+    ARROW_CHECK_OK(city->Append(cols.city[i]));
+    ARROW_CHECK_OK(a->Append(cols.a[i]));
+    ARROW_CHECK_OK(b->Append(cols.b[i]));
+    ARROW_CHECK_OK(c->Append(cols.c[i]));
+    ARROW_CHECK_OK(x->Append(cols.x[i]));
+    ARROW_CHECK_OK(y->Append(cols.y[i]));
+    ARROW_CHECK_OK(z->Append(cols.z[i]));
+  }
+  std::shared_ptr<arrow::Array> out;
+  ARROW_CHECK_OK(builder->Finish(&out));
+  return out;
+}
+
+std::shared_ptr<arrow::Array> bulk(const columns& cols, int64_t n) {
+  auto builder = make_builder();
+  ARROW_CHECK_OK(append_struct_columns(builder.get(), n, nullptr, 0, cols.name,
+                                       cols.city, cols.a, cols.b, cols.c, cols.x,
+                                       cols.y, cols.z));
+  std::shared_ptr<arrow::Array> out;
+  ARROW_CHECK_OK(builder->Finish(&out));
+  return out;
+}
+
+std::shared_ptr<arrow::Array> flat(const columns& cols, int64_t n) {
+  arrow::ArrayVector children(8);
+  arrow::StringBuilder str;
+  ARROW_CHECK_OK(str.AppendValues(cols.name));
+  ARROW_CHECK_OK(str.Finish(&children[0]));
+  ARROW_CHECK_OK(str.AppendValues(cols.city));
+  ARROW_CHECK_OK(str.Finish(&children[1]));
+  arrow::Int64Builder ints;
+  for (int i = 0; i < 3; ++i) {
+    const auto& values = i == 0 ? cols.a : (i == 1 ? cols.b : cols.c);
+    ARROW_CHECK_OK(ints.AppendValues(values.data(), n));
+    ARROW_CHECK_OK(ints.Finish(&children[2 + i]));
+  }
+  arrow::DoubleBuilder dbls;
+  for (int i = 0; i < 3; ++i) {
+    const auto& values = i == 0 ? cols.x : (i == 1 ? cols.y : cols.z);
+    ARROW_CHECK_OK(dbls.AppendValues(values.data(), n));
+    ARROW_CHECK_OK(dbls.Finish(&children[5 + i]));
+  }
+  return std::make_shared<arrow::StructArray>(struct_type(), n, children);
+}
+
+template <typename Fn>
+std::shared_ptr<arrow::Array> time_it(const char* label, int64_t nrows, Fn&& fn) {
+  auto start = std::chrono::steady_clock::now();
+  auto out = fn();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << label << ": " << elapsed.count() << " s, "
+            << static_cast<double>(nrows) / elapsed.count() / 1e6 << " M rows/s"
+            << std::endl;
+  return out;
+}
+
+int main(int argc, char** argv) {
+  const int64_t n = argc > 1 ? std::atoll(argv[1]) : 4 << 20;
+  columns cols;
+  for (int64_t i = 0; i < n; ++i) {
+    cols.name.push_back("name-" + std::to_string(i % 1000));
+    cols.city.push_back("city-" + std::to_string(i % 37));
+    cols.a.push_back(i);
+    cols.b.push_back(i * 2);
+    cols.c.push_back(i * 3);
+    cols.x.push_back(i * 0.5);
+    cols.y.push_back(i * 0.25);
+    cols.z.push_back(i * 0.125);
+  }
+
+  auto expected = time_it("row-wise StructBuilder", n, [&] { return row_wise(cols, n); });
+  auto actual = time_it("append_struct_columns", n, [&] { return bulk(cols, n); });
+  auto flat_columns = time_it("flat column builders", n, [&] { return flat(cols, n); });
+  std::cout << "equal: " << std::boolalpha
+            << (expected->Equals(*actual) && expected->Equals(*flat_columns))
+            << std::endl;
+}
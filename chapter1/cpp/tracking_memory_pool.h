@@ -0,0 +1,180 @@
+// MIT License
+//
+// Copyright (c) 2024 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/memory_pool.h>
+#include <arrow/status.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// A MemoryPool that forwards to another pool and records what goes through
+// it: bytes allocated, the peak, the number of live allocations,
+// reallocations, and a histogram of request sizes in power-of-two buckets.
+// Give each subsystem its own pool via tracked_pool("csv_read") and so on, and
+// call report_memory_at_exit() once in main to get a summary on stderr.
+class TrackingMemoryPool : public arrow::MemoryPool {
+ public:
+  explicit TrackingMemoryPool(std::string label,
+                              arrow::MemoryPool* wrapped = arrow::default_memory_pool())
+      : label_(std::move(label)), wrapped_(wrapped) {}
+
+  using arrow::MemoryPool::Allocate;
+  using arrow::MemoryPool::Free;
+  using arrow::MemoryPool::Reallocate;
+
+  arrow::Status Allocate(int64_t size, int64_t alignment, uint8_t** out) override {
+    ARROW_RETURN_NOT_OK(wrapped_->Allocate(size, alignment, out));
+    ++live_;
+    ++num_allocations_;
+    record(size, size);
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Reallocate(int64_t old_size, int64_t new_size, int64_t alignment,
+                           uint8_t** ptr) override {
+    ARROW_RETURN_NOT_OK(wrapped_->Reallocate(old_size, new_size, alignment, ptr));
+    ++num_reallocations_;
+    record(new_size, new_size - old_size);
+    return arrow::Status::OK();
+  }
+
+  void Free(uint8_t* buffer, int64_t size, int64_t alignment) override {
+    wrapped_->Free(buffer, size, alignment);
+    --live_;
+    bytes_allocated_ -= size;
+  }
+
+  void ReleaseUnused() override { wrapped_->ReleaseUnused(); }
+
+  int64_t bytes_allocated() const override { return bytes_allocated_; }
+  int64_t max_memory() const override { return max_memory_; }
+  int64_t total_bytes_allocated() const override { return total_bytes_allocated_; }
+  int64_t num_allocations() const override {
+    return num_allocations_ + num_reallocations_;
+  }
+  std::string backend_name() const override { return wrapped_->backend_name(); }
+
+  const std::string& label() const { return label_; }
+  int64_t live_allocations() const { return live_; }
+  int64_t num_reallocations() const { return num_reallocations_; }
+
+  void PrintStats() override { Report(std::cerr); }
+
+  void Report(std::ostream& os) const {
+    os << label_ << " (" << backend_name() << ")\n"
+       << "  total allocated: " << total_bytes_allocated_ << " bytes\n"
+       << "  peak:            " << max_memory_ << " bytes\n"
+       << "  in use:          " << bytes_allocated_ << " bytes in " << live_
+       << " allocations\n"
+       << "  allocations:     " << num_allocations_ << "\n"
+       << "  reallocations:   " << num_reallocations_ << "\n"
+       << "  request sizes:\n";
+    for (size_t bucket = 0; bucket < histogram_.size(); ++bucket) {
+      int64_t count = histogram_[bucket];
+      if (count == 0) continue;
+      os << "    <= " << std::setw(20) << std::left << bucket_limit(bucket) << count
+         << "\n";
+    }
+  }
+
+ private:
+  // bucket b counts requests of at most 2^b bytes
+  static int bucket_of(int64_t size) {
+    return size <= 1 ? 0 : 64 - __builtin_clzll(static_cast<uint64_t>(size - 1));
+  }
+  static std::string bucket_limit(size_t bucket) {
+    static const char* kUnits[] = {"B", "KB", "MB", "GB", "TB", "PB", "EB"};
+    return std::to_string(uint64_t{1} << (bucket % 10)) + " " + kUnits[bucket / 10];
+  }
+
+  void record(int64_t requested, int64_t delta) {
+    ++histogram_[bucket_of(requested)];
+    if (delta > 0) total_bytes_allocated_ += delta;
+    int64_t current = bytes_allocated_ += delta;
+    int64_t peak = max_memory_.load();
+    while (current > peak && !max_memory_.compare_exchange_weak(peak, current)) {
+    }
+  }
+
+  const std::string label_;
+  arrow::MemoryPool* wrapped_;
+
+  std::atomic<int64_t> bytes_allocated_{0};
+  std::atomic<int64_t> max_memory_{0};
+  std::atomic<int64_t> total_bytes_allocated_{0};
+  std::atomic<int64_t> num_allocations_{0};
+  std::atomic<int64_t> num_reallocations_{0};
+  std::atomic<int64_t> live_{0};
+  std::array<std::atomic<int64_t>, 64> histogram_{};
+};
+
+namespace tracking_detail {
+
+struct registry {
+  std::mutex mutex;
+  std::map<std::string, std::unique_ptr<TrackingMemoryPool>> pools;
+};
+
+// never destroyed, buffers may still be released during static destruction
+inline registry& get_registry() {
+  static registry* instance = new registry;
+  return *instance;
+}
+
+}  // namespace tracking_detail
+
+// Returns the tracking pool for label, creating it (on top of wrapped) the
+// first time the label is seen. The pools live until the process exits.
+inline arrow::MemoryPool* tracked_pool(
+    const std::string& label, arrow::MemoryPool* wrapped = arrow::default_memory_pool()) {
+  auto& reg = tracking_detail::get_registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  auto& pool = reg.pools[label];
+  if (!pool) {
+    pool = std::make_unique<TrackingMemoryPool>(label, wrapped);
+  }
+  return pool.get();
+}
+
+inline void print_memory_report(std::ostream& os = std::cerr) {
+  auto& reg = tracking_detail::get_registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  os << "memory report\n";
+  for (const auto& [label, pool] : reg.pools) {
+    pool->Report(os);
+  }
+}
+
+inline void report_memory_at_exit() {
+  static std::once_flag once;
+  std::call_once(once, [] { std::atexit([] { print_memory_report(std::cerr); }); });
+}
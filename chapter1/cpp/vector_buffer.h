@@ -0,0 +1,62 @@
+// MIT License
+//
+// Copyright (c) 2024 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <arrow/type_traits.h>
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Moves a vector into an arrow::Buffer that owns its storage. Unlike
+// Buffer::Wrap, the caller doesn't have to keep the vector alive, and unlike
+// copying into a builder there is no second allocation or memcpy, so peak
+// memory during the hand off stays at one copy of the data. Only taking an
+// rvalue makes the transfer of ownership explicit at the call site.
+template <typename T>
+std::shared_ptr<arrow::Buffer> AdoptVector(std::vector<T>&& values) {
+  static_assert(std::is_trivial_v<T>, "only vectors of trivial types can be adopted");
+  return arrow::Buffer::FromVector(std::move(values));
+}
+
+// Builds a primitive array that takes over the storage of `values`. An
+// optional validity bitmap (and its null count, if known) can be passed in,
+// e.g. another adopted vector of bytes.
+template <typename T>
+std::shared_ptr<typename arrow::CTypeTraits<T>::ArrayType> MakeArrayFromVector(
+    std::vector<T>&& values, std::shared_ptr<arrow::Buffer> validity = nullptr,
+    int64_t null_count = arrow::kUnknownNullCount) {
+  static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>,
+                "std::vector<bool> is bit-packed and can't be adopted");
+  const auto length = static_cast<int64_t>(values.size());
+  if (validity == nullptr) {
+    null_count = 0;
+  }
+  auto buffer = AdoptVector(std::move(values));
+  auto data = arrow::ArrayData::Make(arrow::CTypeTraits<T>::type_singleton(), length,
+                                     {std::move(validity), std::move(buffer)},
+                                     null_count);
+  return std::make_shared<typename arrow::CTypeTraits<T>::ArrayType>(std::move(data));
+}
@@ -0,0 +1,249 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/buffer.h>
+#include <arrow/io/interfaces.h>
+#include <arrow/memory_pool.h>
+#include <arrow/result.h>
+#include <arrow/status.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+struct async_output_stats {
+  int64_t buffers_written = 0;
+  int64_t bytes_written = 0;
+  // filled buffers waiting for the writer thread, now and at most
+  int64_t queue_depth = 0;
+  int64_t max_queue_depth = 0;
+  // how often and for how long Write had to wait for the writer thread to
+  // hand a buffer back, i.e. the time the I/O wasn't hidden
+  int64_t num_stalls = 0;
+  std::chrono::nanoseconds stall_time{0};
+  // time the writer thread spent in the wrapped stream's Write
+  std::chrono::nanoseconds write_time{0};
+};
+
+// An OutputStream decorator that copies writes into one of `num_buffers`
+// buffers and hands each full buffer to a background thread which writes it to
+// the wrapped stream, so whoever produces the data (a CSV, Parquet or ORC
+// writer) keeps going while the previous buffer is being written. With two
+// buffers this is double buffering; Write only blocks when every buffer is
+// queued. Errors from the wrapped stream are returned by the next call.
+class AsyncOutputStream : public arrow::io::OutputStream {
+ public:
+  static arrow::Result<std::shared_ptr<AsyncOutputStream>> Create(
+      std::shared_ptr<arrow::io::OutputStream> raw, int64_t buffer_size = 1 << 20,
+      int num_buffers = 2, arrow::MemoryPool* pool = arrow::default_memory_pool()) {
+    if (buffer_size <= 0 || num_buffers < 2) {
+      return arrow::Status::Invalid("need at least 2 buffers of a positive size");
+    }
+    std::shared_ptr<AsyncOutputStream> stream(
+        new AsyncOutputStream(std::move(raw), buffer_size));
+    for (int i = 0; i < num_buffers; ++i) {
+      ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::ResizableBuffer> buffer,
+                            arrow::AllocateResizableBuffer(buffer_size, pool));
+      stream->free_.push_back(std::move(buffer));
+    }
+    stream->writer_ = std::thread([s = stream.get()] { s->write_loop(); });
+    return stream;
+  }
+
+  ~AsyncOutputStream() override {
+    // like Arrow's own streams, an error closing from here can only be logged
+    if (!closed_) {
+      auto status = Close();
+      if (!status.ok()) status.Warn();
+    }
+  }
+
+  arrow::Status Write(const void* data, int64_t nbytes) override {
+    if (closed_) return arrow::Status::Invalid("write to a closed stream");
+    auto bytes = static_cast<const uint8_t*>(data);
+    position_ += nbytes;
+    while (nbytes > 0) {
+      if (!current_) ARROW_RETURN_NOT_OK(next_buffer());
+      const int64_t n = std::min(nbytes, buffer_size_ - current_size_);
+      std::memcpy(current_->mutable_data() + current_size_, bytes, n);
+      current_size_ += n;
+      bytes += n;
+      nbytes -= n;
+      if (current_size_ == buffer_size_) ARROW_RETURN_NOT_OK(submit());
+    }
+    return arrow::Status::OK();
+  }
+  using arrow::io::OutputStream::Write;
+
+  // hands over the partially filled buffer and waits until everything
+  // written so far has reached the wrapped stream
+  arrow::Status Flush() override {
+    if (closed_) return arrow::Status::Invalid("flush of a closed stream");
+    ARROW_RETURN_NOT_OK(drain());
+    return raw_->Flush();
+  }
+
+  arrow::Status Close() override {
+    if (closed_) return arrow::Status::OK();
+    auto status = drain();
+    stop_writer();
+    closed_ = true;
+    return status & raw_->Close();
+  }
+
+  arrow::Status Abort() override {
+    if (closed_) return arrow::Status::OK();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.clear();
+    }
+    stop_writer();
+    closed_ = true;
+    return raw_->Abort();
+  }
+
+  bool closed() const override { return closed_; }
+  arrow::Result<int64_t> Tell() const override { return position_; }
+
+  async_output_stats stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+ private:
+  struct pending {
+    std::shared_ptr<arrow::ResizableBuffer> buffer;
+    int64_t size;
+  };
+
+  AsyncOutputStream(std::shared_ptr<arrow::io::OutputStream> raw, int64_t buffer_size)
+      : raw_(std::move(raw)), buffer_size_(buffer_size) {}
+
+  // takes a free buffer to fill, waiting for the writer if there is none
+  arrow::Status next_buffer() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+      ++stats_.num_stalls;
+      auto start = std::chrono::steady_clock::now();
+      cv_.wait(lock, [&] { return !free_.empty() || !status_.ok(); });
+      stats_.stall_time += std::chrono::steady_clock::now() - start;
+    }
+    ARROW_RETURN_NOT_OK(status_);
+    current_ = std::move(free_.back());
+    free_.pop_back();
+    current_size_ = 0;
+    return arrow::Status::OK();
+  }
+
+  arrow::Status submit() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ARROW_RETURN_NOT_OK(status_);
+    queue_.push_back({std::move(current_), current_size_});
+    current_size_ = 0;
+    stats_.queue_depth = queue_.size();
+    stats_.max_queue_depth = std::max(stats_.max_queue_depth, stats_.queue_depth);
+    cv_.notify_all();
+    return arrow::Status::OK();
+  }
+
+  arrow::Status drain() {
+    if (current_ && current_size_ > 0) ARROW_RETURN_NOT_OK(submit());
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return (queue_.empty() && !busy_) || !status_.ok(); });
+    return status_;
+  }
+
+  void stop_writer() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    if (writer_.joinable()) writer_.join();
+  }
+
+  void write_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) return;  // only once stopped and drained
+      auto item = std::move(queue_.front());
+      queue_.pop_front();
+      stats_.queue_depth = queue_.size();
+      busy_ = true;
+
+      // after an error the buffers are just recycled so no one waits forever
+      if (status_.ok()) {
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        auto status = raw_->Write(item.buffer->data(), item.size);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        lock.lock();
+        status_ &= status;
+        stats_.write_time += elapsed;
+        ++stats_.buffers_written;
+        stats_.bytes_written += item.size;
+      }
+      free_.push_back(std::move(item.buffer));
+      busy_ = false;
+      cv_.notify_all();
+    }
+  }
+
+  std::shared_ptr<arrow::io::OutputStream> raw_;
+  const int64_t buffer_size_;
+
+  // only touched by the thread calling Write
+  std::shared_ptr<arrow::ResizableBuffer> current_;
+  int64_t current_size_ = 0;
+  int64_t position_ = 0;
+  bool closed_ = false;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<pending> queue_;
+  std::vector<std::shared_ptr<arrow::ResizableBuffer>> free_;
+  arrow::Status status_;
+  bool busy_ = false;
+  bool stop_ = false;
+  async_output_stats stats_;
+  std::thread writer_;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const async_output_stats& stats) {
+  return os << stats.bytes_written << " bytes in " << stats.buffers_written
+            << " buffers, max queue depth " << stats.max_queue_depth << ", "
+            << stats.num_stalls << " stalls ("
+            << std::chrono::duration<double>(stats.stall_time).count() << "s), "
+            << std::chrono::duration<double>(stats.write_time).count()
+            << "s in writes";
+}
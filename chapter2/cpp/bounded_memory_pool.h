@@ -0,0 +1,178 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/memory_pool.h>
+#include <arrow/status.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// A MemoryPool with a hard ceiling on the bytes it has handed out. An
+// allocation that would go over the limit waits for other buffers to be
+// released, which is how a reader thread that runs ahead of its consumer gets
+// slowed down. By default it waits for as long as it takes, a slow consumer is
+// only backpressure. With a `max_wait` it fails with OutOfMemory if nothing is
+// released in time, it always does if the request alone is larger than the
+// limit.
+//
+// Readers hand their allocations to background threads which can outlive the
+// reader object itself, so the destructor fails any waiting allocations and
+// then blocks until every buffer from the pool has been freed.
+class BoundedMemoryPool : public arrow::MemoryPool {
+ public:
+  static constexpr std::chrono::milliseconds kWaitForever =
+      std::chrono::milliseconds::max();
+
+  explicit BoundedMemoryPool(int64_t limit,
+                             std::chrono::milliseconds max_wait = kWaitForever,
+                             arrow::MemoryPool* wrapped = arrow::default_memory_pool())
+      : limit_(limit), max_wait_(max_wait), wrapped_(wrapped) {}
+
+  ~BoundedMemoryPool() override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    closed_ = true;
+    released_.notify_all();
+    released_.wait(lock, [&] { return used_ == 0 && num_waiting_ == 0; });
+  }
+
+  using arrow::MemoryPool::Allocate;
+  using arrow::MemoryPool::Free;
+  using arrow::MemoryPool::Reallocate;
+
+  arrow::Status Allocate(int64_t size, int64_t alignment, uint8_t** out) override {
+    ARROW_RETURN_NOT_OK(reserve(size));
+    auto status = wrapped_->Allocate(size, alignment, out);
+    if (!status.ok()) release(size);
+    return status;
+  }
+
+  arrow::Status Reallocate(int64_t old_size, int64_t new_size, int64_t alignment,
+                           uint8_t** ptr) override {
+    const int64_t delta = new_size - old_size;
+    if (delta > 0) ARROW_RETURN_NOT_OK(reserve(delta));
+    auto status = wrapped_->Reallocate(old_size, new_size, alignment, ptr);
+    if (!status.ok()) {
+      if (delta > 0) release(delta);
+      return status;
+    }
+    if (delta < 0) release(-delta);
+    return status;
+  }
+
+  void Free(uint8_t* buffer, int64_t size, int64_t alignment) override {
+    wrapped_->Free(buffer, size, alignment);
+    release(size);
+  }
+
+  int64_t bytes_allocated() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return used_;
+  }
+  int64_t max_memory() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return peak_;
+  }
+  int64_t total_bytes_allocated() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_;
+  }
+  int64_t num_allocations() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_allocations_;
+  }
+  std::string backend_name() const override { return wrapped_->backend_name(); }
+
+  int64_t limit() const { return limit_; }
+  // how many allocations had to wait for memory, and for how long in total
+  int64_t num_stalls() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_stalls_;
+  }
+  std::chrono::nanoseconds stall_time() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stall_time_;
+  }
+
+ private:
+  arrow::Status reserve(int64_t size) {
+    if (size > limit_) {
+      return arrow::Status::OutOfMemory("allocation of ", size,
+                                        " bytes exceeds the memory limit of ", limit_);
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_) return arrow::Status::Cancelled("memory pool is being destroyed");
+    if (used_ + size > limit_) {
+      ++num_stalls_;
+      ++num_waiting_;
+      auto start = std::chrono::steady_clock::now();
+      auto can_proceed = [&] { return closed_ || used_ + size <= limit_; };
+      if (max_wait_ == kWaitForever) {
+        released_.wait(lock, can_proceed);
+      } else {
+        released_.wait_for(lock, max_wait_, can_proceed);
+      }
+      stall_time_ += std::chrono::steady_clock::now() - start;
+      --num_waiting_;
+      if (closed_) {
+        released_.notify_all();
+        return arrow::Status::Cancelled("memory pool is being destroyed");
+      }
+      if (used_ + size > limit_) {
+        return arrow::Status::OutOfMemory("memory limit of ", limit_, " bytes reached (",
+                                          used_, " in use, ", size, " requested)");
+      }
+    }
+    used_ += size;
+    total_ += size;
+    peak_ = std::max(peak_, used_);
+    ++num_allocations_;
+    return arrow::Status::OK();
+  }
+
+  void release(int64_t size) {
+    // notify under the lock, the destructor may be waiting for this release
+    std::lock_guard<std::mutex> lock(mutex_);
+    used_ -= size;
+    released_.notify_all();
+  }
+
+  const int64_t limit_;
+  const std::chrono::milliseconds max_wait_;
+  arrow::MemoryPool* wrapped_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable released_;
+  int64_t used_ = 0;
+  int64_t peak_ = 0;
+  int64_t total_ = 0;
+  int64_t num_allocations_ = 0;
+  int64_t num_stalls_ = 0;
+  int64_t num_waiting_ = 0;
+  bool closed_ = false;
+  std::chrono::nanoseconds stall_time_{0};
+};
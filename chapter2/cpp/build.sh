@@ -29,3 +29,10 @@ g++ csv_writer.cc -o csv_writer `pkg-config --cflags --libs arrow-csv` $LDARGS
 g++ json_reader.cc -o json_reader `pkg-config --cflags --libs arrow-json` $LDARGS
 g++ orc_reader_writer.cc -o orc_reader_writer `pkg-config --cflags --libs arrow-orc` $LDARGS
 g++ parquet_reader_writer.cc -o parquet_reader_writer `pkg-config --cflags --libs parquet` $LDARGS
+g++ csv_read_bench.cc -O3 -o csv_read_bench `pkg-config --cflags --libs arrow-csv` $LDARGS
+g++ input_mode_compare.cc -O3 -o input_mode_compare `pkg-config --cflags --libs arrow-csv arrow-orc parquet` $LDARGS
+g++ csv_to_parquet.cc -O3 -o csv_to_parquet `pkg-config --cflags --libs arrow-csv parquet` $LDARGS
+g++ json_writer.cc -O3 -o json_writer `pkg-config --cflags --libs arrow-csv parquet` $LDARGS
+g++ orc_write_bench.cc -O3 -o orc_write_bench `pkg-config --cflags --libs arrow-orc` $LDARGS
+g++ parquet_write_bench.cc -O3 -o parquet_write_bench `pkg-config --cflags --libs parquet` $LDARGS
+g++ parquet_lookup_bench.cc -O3 -o parquet_lookup_bench `pkg-config --cflags --libs parquet arrow-compute` $LDARGS
@@ -0,0 +1,165 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <arrow/csv/api.h>
+#include <arrow/io/api.h>
+#include <arrow/memory_pool.h>
+#include <arrow/table.h>
+#include <arrow/util/logging.h>
+#include <arrow/util/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Reads each CSV file with every combination of block_size, use_threads and
+// CPU thread pool capacity, repeating each configuration and keeping the
+// median time. Prints one JSON document to stdout:
+//
+//   {"host": {...}, "results": [{"file": ..., "block_size": ..., "use_threads":
+//    ..., "threads": ..., "mb_per_sec": ..., "rows_per_sec": ...,
+//    "peak_memory_bytes": ..., "scaling_efficiency": ...}, ...]}
+//
+// scaling_efficiency is the threaded throughput divided by `threads` times the
+// single threaded throughput with the same block size, 1.0 is perfect scaling.
+// Usage: csv_read_bench [repetitions] [file...], defaults to 3 repetitions of
+// train.csv and yellow_tripdata_2015-01.csv.
+
+struct read_config {
+  int32_t block_size;
+  bool use_threads;
+  int threads;
+};
+
+struct read_result {
+  read_config config;
+  double seconds;  // median over the repetitions
+  int64_t num_rows;
+  int64_t peak_memory;  // largest over the repetitions
+};
+
+arrow::Result<read_result> run_config(const std::string& path, const read_config& config,
+                                      int repetitions) {
+  ARROW_RETURN_NOT_OK(arrow::SetCpuThreadPoolCapacity(config.threads));
+
+  read_result result{config, 0, 0, 0};
+  std::vector<double> times;
+  for (int i = 0; i < repetitions; ++i) {
+    // a fresh proxy per run so max_memory is the peak of this run alone
+    arrow::ProxyMemoryPool pool(arrow::default_memory_pool());
+    ARROW_ASSIGN_OR_RAISE(auto input, arrow::io::ReadableFile::Open(path, &pool));
+
+    auto read_options = arrow::csv::ReadOptions::Defaults();
+    read_options.block_size = config.block_size;
+    read_options.use_threads = config.use_threads;
+
+    auto start = std::chrono::steady_clock::now();
+    ARROW_ASSIGN_OR_RAISE(
+        auto reader, arrow::csv::TableReader::Make(
+                         arrow::io::IOContext(&pool), input, read_options,
+                         arrow::csv::ParseOptions::Defaults(),
+                         arrow::csv::ConvertOptions::Defaults()));
+    ARROW_ASSIGN_OR_RAISE(auto table, reader->Read());
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    times.push_back(elapsed.count());
+    result.num_rows = table->num_rows();
+    result.peak_memory = std::max(result.peak_memory, pool.max_memory());
+  }
+
+  std::sort(times.begin(), times.end());
+  result.seconds = times[times.size() / 2];
+  return result;
+}
+
+std::vector<read_config> make_sweep() {
+  const std::vector<int32_t> block_sizes{1 << 18, 1 << 20, 1 << 22, 1 << 24};
+  std::vector<int> thread_counts;
+  const int hardware = std::max(1u, std::thread::hardware_concurrency());
+  for (int n = 1; n < hardware; n *= 2) {
+    thread_counts.push_back(n);
+  }
+  thread_counts.push_back(hardware);
+
+  std::vector<read_config> sweep;
+  for (auto block_size : block_sizes) {
+    // the serial run comes first, it is the baseline for the scaling efficiency
+    sweep.push_back({block_size, false, 1});
+    for (auto threads : thread_counts) {
+      sweep.push_back({block_size, true, threads});
+    }
+  }
+  return sweep;
+}
+
+int main(int argc, char** argv) {
+  const int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 3;
+  std::vector<std::string> files(argv + std::min(argc, 2), argv + argc);
+  if (files.empty()) {
+    files = {"../../sample_data/train.csv",
+             "../../sample_data/yellow_tripdata_2015-01.csv"};
+  }
+
+  const int default_threads = arrow::GetCpuThreadPoolCapacity();
+  std::cout << "{\n  \"host\": {\"hardware_concurrency\": "
+            << std::thread::hardware_concurrency()
+            << ", \"default_cpu_threads\": " << default_threads
+            << ", \"repetitions\": " << repetitions << "},\n  \"results\": [";
+
+  bool first = true;
+  for (const auto& path : files) {
+    auto file_size = arrow::io::ReadableFile::Open(path)
+                         .ValueOrDie()
+                         ->GetSize()
+                         .ValueOrDie();
+    double serial_throughput = 0;
+    for (const auto& config : make_sweep()) {
+      auto maybe_result = run_config(path, config, repetitions);
+      if (!maybe_result.ok()) {
+        std::cerr << path << ": " << maybe_result.status().ToString() << std::endl;
+        return 1;
+      }
+      const auto& r = *maybe_result;
+      const double throughput = file_size / r.seconds;
+      if (!config.use_threads) serial_throughput = throughput;
+
+      std::cout << (first ? "\n" : ",\n") << "    {\"file\": \"" << path
+                << "\", \"file_bytes\": " << file_size
+                << ", \"block_size\": " << config.block_size
+                << ", \"use_threads\": " << (config.use_threads ? "true" : "false")
+                << ", \"threads\": " << config.threads << ", \"seconds\": " << r.seconds
+                << ", \"mb_per_sec\": " << throughput / (1 << 20)
+                << ", \"rows_per_sec\": " << r.num_rows / r.seconds
+                << ", \"peak_memory_bytes\": " << r.peak_memory
+                << ", \"scaling_efficiency\": "
+                << throughput / (config.threads * serial_throughput) << "}";
+      first = false;
+    }
+  }
+  std::cout << "\n  ]\n}" << std::endl;
+
+  ARROW_CHECK_OK(arrow::SetCpuThreadPoolCapacity(default_threads));
+}
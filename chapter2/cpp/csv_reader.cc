@@ -20,14 +20,154 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <arrow/api.h>
 #include <arrow/csv/api.h>  // the csv functions and objects
 #include <arrow/io/api.h>   // for opening the file
 #include <arrow/table.h>    // to read the data into a table
-#include <iostream>         // to output to the terminal
+#include <sys/resource.h>   // getrusage for the peak RSS
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>  // to output to the terminal
+
+#include "../../chapter1/cpp/tracking_memory_pool.h"
+#include "bounded_memory_pool.h"
+#include "csv_schema_cache.h"
+#include "input_file.h"
+
+struct streaming_options {
+  // how many bytes of CSV are parsed into each record batch
+  int32_t block_size = 1 << 20;
+  // ceiling on the memory the reader may hold at once, the reader waits for
+  // the consumer to release batches when it is reached. A quarter of it goes
+  // to the raw blocks read ahead of the parser, the rest to parsing and
+  // conversion, so readahead can never starve the decoding.
+  int64_t memory_limit = int64_t{256} << 20;
+  bool use_threads = true;
+  // when memory mapped the raw blocks are slices of the mapping, so there is
+  // no readahead share and all of the limit goes to decoding
+  input_mode mode = input_mode::read;
+};
+
+using batch_consumer =
+    std::function<arrow::Status(const std::shared_ptr<arrow::RecordBatch>&)>;
+
+// peak resident set size of this process so far, in bytes
+int64_t peak_rss_bytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return int64_t{usage.ru_maxrss} * 1024;  // ru_maxrss is in KiB on Linux
+}
+
+// Reads the file one block at a time instead of materializing it as a single
+// Table, handing each batch to the consumer as soon as it has been converted.
+// Memory stays proportional to block_size rather than to the file size as long
+// as the consumer doesn't hold on to the batches, which it must not keep past
+// the end of the stream either.
+arrow::Status stream_csv(const std::string& path, const streaming_options& opts,
+                         const batch_consumer& consumer) {
+  // the parser holds on to the current block and the one before it (for the
+  // row that straddles them) while the next one is being read, so readahead
+  // needs room for a few blocks or it waits on itself, while parsing and
+  // conversion keep a handful of blocks in flight
+  const bool mapped = opts.mode == input_mode::memory_map;
+  const int64_t readahead_limit = mapped ? 0 : opts.memory_limit / 4;
+  const int64_t decode_limit = opts.memory_limit - readahead_limit;
+  if ((!mapped && readahead_limit < int64_t{4} * opts.block_size) ||
+      decode_limit < int64_t{8} * opts.block_size) {
+    return arrow::Status::Invalid("memory limit of ", opts.memory_limit,
+                                  " bytes is too small for a block size of ",
+                                  opts.block_size);
+  }
+
+  // the file allocates the raw blocks, the reader everything decoded from them
+  BoundedMemoryPool readahead_pool(readahead_limit);
+  BoundedMemoryPool pool(decode_limit);
+  ARROW_ASSIGN_OR_RAISE(
+      auto input, open_input(path, opts.mode, access_hint::sequential, &readahead_pool));
+  ARROW_ASSIGN_OR_RAISE(auto file_size, input->GetSize());
+
+  auto read_options = arrow::csv::ReadOptions::Defaults();
+  read_options.block_size = opts.block_size;
+  read_options.use_threads = opts.use_threads;
+
+  const auto start = std::chrono::steady_clock::now();
+  ARROW_ASSIGN_OR_RAISE(
+      auto reader, arrow::csv::StreamingReader::Make(
+                       arrow::io::IOContext(&pool), input, read_options,
+                       arrow::csv::ParseOptions::Defaults(),
+                       arrow::csv::ConvertOptions::Defaults()));
+
+  int64_t num_rows = 0;
+  int64_t num_batches = 0;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while (true) {
+    ARROW_RETURN_NOT_OK(reader->ReadNext(&batch));
+    if (!batch) break;
+    num_rows += batch->num_rows();
+    ++num_batches;
+    ARROW_RETURN_NOT_OK(consumer(batch));
+    batch.reset();
+  }
+  ARROW_RETURN_NOT_OK(reader->Close());
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  const double secs = elapsed.count();
+  std::cout << "streamed " << num_rows << " rows in " << num_batches << " batches, "
+            << secs << "s\n"
+            << "  " << num_rows / secs << " rows/s, " << file_size / secs / (1 << 20)
+            << " MB/s\n"
+            << "  readahead peak " << readahead_pool.max_memory() << " of "
+            << readahead_pool.limit() << " bytes, " << readahead_pool.num_stalls()
+            << " stalls ("
+            << std::chrono::duration<double>(readahead_pool.stall_time()).count()
+            << "s)\n"
+            << "  decode peak " << pool.max_memory() << " of " << pool.limit()
+            << " bytes, " << pool.num_stalls() << " stalls ("
+            << std::chrono::duration<double>(pool.stall_time()).count() << "s)\n"
+            << "  peak RSS " << peak_rss_bytes() << " bytes" << std::endl;
+  return arrow::Status::OK();
+}
 
 int main(int argc, char** argv) {
-  auto maybe_input =
-      arrow::io::ReadableFile::Open("../../sample_data/train.csv");
+  // any of the modes below can add --mmap to map the file instead of reading it
+  const input_mode mode = parse_input_mode(argc, argv);
+
+  // csv_reader --stream [block_size] [memory_limit]
+  if (argc > 1 && std::strcmp(argv[1], "--stream") == 0) {
+    streaming_options opts;
+    opts.mode = mode;
+    if (argc > 2) opts.block_size = std::atoi(argv[2]);
+    if (argc > 3) opts.memory_limit = std::atoll(argv[3]);
+
+    // stands in for real work, just look at each batch and let it go
+    int64_t null_count = 0;
+    auto status = stream_csv("../../sample_data/train.csv", opts,
+                             [&](const std::shared_ptr<arrow::RecordBatch>& batch) {
+                               for (const auto& col : batch->columns()) {
+                                 null_count += col->null_count();
+                               }
+                               return arrow::Status::OK();
+                             });
+    if (!status.ok()) {
+      std::cerr << status.ToString() << std::endl;
+      return 1;
+    }
+    std::cout << "nulls: " << null_count << std::endl;
+    return 0;
+  }
+
+  // csv_reader --schema-cache reuses the types inferred by the previous run
+  const bool use_schema_cache = argc > 1 && std::strcmp(argv[1], "--schema-cache") == 0;
+  const std::string path = "../../sample_data/train.csv";
+
+  // print where the memory went when we exit
+  report_memory_at_exit();
+
+  auto maybe_input = open_input(path, mode, access_hint::sequential);
   if (!maybe_input.ok()) {
     // handle any file open errors
     std::cerr << maybe_input.status().message() << std::endl;
@@ -35,11 +175,24 @@ int main(int argc, char** argv) {
   }
 
   std::shared_ptr<arrow::io::InputStream> input = *maybe_input;
-  auto io_context = arrow::io::default_io_context();
+  // all of the reader's allocations are tracked under "csv_read"
+  auto io_context = arrow::io::IOContext(tracked_pool("csv_read"));
   auto read_options = arrow::csv::ReadOptions::Defaults();
   auto parse_options = arrow::csv::ParseOptions::Defaults();
   auto convert_options = arrow::csv::ConvertOptions::Defaults();
 
+  bool cached = false;
+  if (use_schema_cache) {
+    // a stale or missing entry just means we infer the types as usual
+    auto maybe_cached = load_cached_schema(path, &convert_options);
+    if (!maybe_cached.ok()) {
+      std::cerr << maybe_cached.status().message() << std::endl;
+      return 1;
+    }
+    cached = *maybe_cached;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
   auto maybe_reader = arrow::csv::TableReader::Make(
       io_context, input, read_options, parse_options, convert_options);
 
@@ -61,4 +214,18 @@ int main(int argc, char** argv) {
 
   std::shared_ptr<arrow::Table> table = *maybe_table;
   std::cout << table->ToString() << std::endl;
+
+  if (use_schema_cache) {
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << (cached ? "read with cached schema in " : "read with type inference in ")
+              << elapsed.count() << "s" << std::endl;
+    if (!cached) {
+      auto status = store_cached_schema(path, *table->schema(), convert_options);
+      if (!status.ok()) {
+        std::cerr << status.message() << std::endl;
+        return 1;
+      }
+    }
+  }
 }
\ No newline at end of file
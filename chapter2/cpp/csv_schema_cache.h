@@ -0,0 +1,167 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/csv/options.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/dictionary.h>
+#include <arrow/ipc/reader.h>
+#include <arrow/ipc/writer.h>
+#include <arrow/type.h>
+#include <arrow/util/key_value_metadata.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// An optional sidecar next to a CSV file (`<file>.schema`) holding the schema
+// that type inference produced for it, so repeat reads of the same file can
+// hand every column's type to the converter and skip inference entirely.
+//
+// The sidecar is an Arrow IPC schema message. Its metadata records the path,
+// size and modification time of the CSV file plus the null/true/false value
+// sets that inference ran with; if any of them no longer match the entry is
+// stale and is ignored, and the next store_cached_schema replaces it.
+
+namespace csv_schema_cache_detail {
+
+// the value sets are stored as <length>:<value> so any string round trips
+inline std::string encode_values(const std::vector<std::string>& values) {
+  std::string out;
+  for (const auto& v : values) {
+    out += std::to_string(v.size()) + ":" + v;
+  }
+  return out;
+}
+
+inline bool decode_values(const std::string& encoded, std::vector<std::string>* out) {
+  size_t pos = 0;
+  while (pos < encoded.size()) {
+    auto colon = encoded.find(':', pos);
+    if (colon == std::string::npos) return false;
+    size_t len = 0;
+    try {
+      len = std::stoul(encoded.substr(pos, colon - pos));
+    } catch (const std::exception&) {
+      return false;
+    }
+    if (colon + 1 + len > encoded.size()) return false;
+    out->push_back(encoded.substr(colon + 1, len));
+    pos = colon + 1 + len;
+  }
+  return true;
+}
+
+struct file_key {
+  std::string path;
+  std::string size;
+  std::string mtime;
+};
+
+inline arrow::Result<file_key> key_for(const std::string& csv_path) {
+  std::error_code ec;
+  auto path = std::filesystem::canonical(csv_path, ec);
+  if (ec) return arrow::Status::IOError("cannot resolve ", csv_path, ": ", ec.message());
+  auto size = std::filesystem::file_size(path, ec);
+  if (ec) return arrow::Status::IOError("cannot stat ", csv_path, ": ", ec.message());
+  auto mtime = std::filesystem::last_write_time(path, ec);
+  if (ec) return arrow::Status::IOError("cannot stat ", csv_path, ": ", ec.message());
+  return file_key{path.string(), std::to_string(size),
+                  std::to_string(mtime.time_since_epoch().count())};
+}
+
+}  // namespace csv_schema_cache_detail
+
+inline std::string schema_cache_path(const std::string& csv_path) {
+  return csv_path + ".schema";
+}
+
+// Fills in options->column_types from the sidecar of `csv_path` when there is
+// a valid one, returning whether it did. A missing, unreadable or stale
+// sidecar is not an error, the read just falls back to inference.
+inline arrow::Result<bool> load_cached_schema(const std::string& csv_path,
+                                              arrow::csv::ConvertOptions* options) {
+  namespace detail = csv_schema_cache_detail;
+  ARROW_ASSIGN_OR_RAISE(auto key, detail::key_for(csv_path));
+
+  auto maybe_file = arrow::io::ReadableFile::Open(schema_cache_path(csv_path));
+  if (!maybe_file.ok()) return false;
+  arrow::ipc::DictionaryMemo memo;
+  auto maybe_schema = arrow::ipc::ReadSchema(maybe_file->get(), &memo);
+  if (!maybe_schema.ok() || !(*maybe_schema)->metadata()) return false;
+  auto schema = *maybe_schema;
+  const auto& metadata = *schema->metadata();
+
+  auto matches = [&](const std::string& name, const std::string& expected) {
+    auto value = metadata.Get(name);
+    return value.ok() && *value == expected;
+  };
+  if (!matches("csv_cache.path", key.path) || !matches("csv_cache.size", key.size) ||
+      !matches("csv_cache.mtime", key.mtime) ||
+      !matches("csv_cache.null_values", detail::encode_values(options->null_values)) ||
+      !matches("csv_cache.true_values", detail::encode_values(options->true_values)) ||
+      !matches("csv_cache.false_values",
+               detail::encode_values(options->false_values))) {
+    return false;
+  }
+
+  // types the caller asked for explicitly win over the cached ones
+  for (const auto& field : schema->fields()) {
+    options->column_types.emplace(field->name(), field->type());
+  }
+  return true;
+}
+
+// Writes the sidecar for `csv_path` after a read whose result had `schema`,
+// using the value sets from the options that read ran with. The file is
+// written next to the sidecar and renamed over it, so concurrent readers see
+// either the old entry or the new one.
+inline arrow::Status store_cached_schema(const std::string& csv_path,
+                                         const arrow::Schema& schema,
+                                         const arrow::csv::ConvertOptions& options) {
+  namespace detail = csv_schema_cache_detail;
+  ARROW_ASSIGN_OR_RAISE(auto key, detail::key_for(csv_path));
+
+  auto metadata = arrow::key_value_metadata(
+      {"csv_cache.path", "csv_cache.size", "csv_cache.mtime", "csv_cache.null_values",
+       "csv_cache.true_values", "csv_cache.false_values"},
+      {key.path, key.size, key.mtime, detail::encode_values(options.null_values),
+       detail::encode_values(options.true_values),
+       detail::encode_values(options.false_values)});
+  ARROW_ASSIGN_OR_RAISE(auto buffer,
+                        arrow::ipc::SerializeSchema(*schema.WithMetadata(metadata)));
+
+  const auto sidecar = schema_cache_path(csv_path);
+  const auto tmp = sidecar + ".tmp";
+  ARROW_ASSIGN_OR_RAISE(auto output, arrow::io::FileOutputStream::Open(tmp));
+  ARROW_RETURN_NOT_OK(output->Write(buffer));
+  ARROW_RETURN_NOT_OK(output->Close());
+
+  std::error_code ec;
+  std::filesystem::rename(tmp, sidecar, ec);
+  if (ec) return arrow::Status::IOError("cannot write ", sidecar, ": ", ec.message());
+  return arrow::Status::OK();
+}
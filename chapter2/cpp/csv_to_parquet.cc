@@ -0,0 +1,192 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <arrow/csv/api.h>
+#include <arrow/io/api.h>
+#include <arrow/record_batch.h>
+#include <arrow/util/byte_size.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/properties.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <iostream>
+#include <string>
+
+#include "async_output_stream.h"
+#include "bounded_memory_pool.h"
+
+// Converts a CSV file to Parquet without ever holding the whole file. The
+// work is pipelined across threads:
+//
+//   read + parse + convert   csv::StreamingReader on the IO and CPU pools,
+//                            running ahead of the encoder
+//   encode                   the calling thread feeds each batch to a
+//                            buffered row group, with its columns encoded in
+//                            parallel on the CPU pool
+//   write                    an AsyncOutputStream writes the encoded pages on
+//                            its own thread
+//
+// Every stage allocates from its own BoundedMemoryPool so the total stays
+// under memory_limit no matter how large the input is: raw CSV blocks get an
+// eighth of it, decoded batches three eighths and the encoded row group being
+// built the remaining half. Row groups are closed once the decoded (Arrow)
+// size of the batches written to them reaches row_group_bytes, the size on
+// disk will usually be quite a bit smaller. Until a row group is closed the
+// encoder buffers its pages and the buffers grow by doubling, several columns
+// at once, so it can briefly need a few times what it holds. A row group is
+// therefore also closed early, whatever row_group_bytes says, once the
+// encoder holds a quarter of its budget: waiting for memory there would only
+// be waiting on itself.
+// Usage: csv_to_parquet [input.csv] [output.parquet] [row_group_MB] [memory_limit_MB]
+
+struct conversion_options {
+  int32_t block_size = 1 << 20;
+  int64_t row_group_bytes = int64_t{128} << 20;
+  int64_t memory_limit = int64_t{512} << 20;
+  parquet::Compression::type compression = parquet::Compression::SNAPPY;
+};
+
+struct conversion_stats {
+  int64_t num_rows = 0;
+  int64_t num_row_groups = 0;
+  int64_t input_bytes = 0;
+  int64_t output_bytes = 0;
+};
+
+arrow::Result<conversion_stats> csv_to_parquet(const std::string& input_path,
+                                               const std::string& output_path,
+                                               const conversion_options& opts) {
+  const int64_t readahead_limit = opts.memory_limit / 8;
+  const int64_t decode_limit = opts.memory_limit * 3 / 8;
+  const int64_t encode_limit = opts.memory_limit - readahead_limit - decode_limit;
+  // the output stream's buffers come out of the encoder's share
+  constexpr int kWriteBuffers = 4;
+  const int64_t write_buffer_size =
+      std::clamp<int64_t>(encode_limit / 16, 64 << 10, 4 << 20);
+  const int64_t row_group_budget = encode_limit - kWriteBuffers * write_buffer_size;
+  // see stream_csv in csv_reader.cc for why readahead needs a few blocks,
+  // while parsing and conversion keep a handful of blocks in flight
+  if (readahead_limit < int64_t{4} * opts.block_size ||
+      decode_limit < int64_t{8} * opts.block_size) {
+    return arrow::Status::Invalid("memory limit of ", opts.memory_limit,
+                                  " bytes is too small for a block size of ",
+                                  opts.block_size);
+  }
+
+  // declared first so they outlive everything allocating from them. Reading
+  // and decoding wait for as long as the encoder takes to catch up, but only
+  // the encoder itself frees encode memory, so waiting there for longer than
+  // its column tasks take would just hang
+  BoundedMemoryPool readahead_pool(readahead_limit);
+  BoundedMemoryPool decode_pool(decode_limit);
+  BoundedMemoryPool encode_pool(encode_limit, std::chrono::seconds(1));
+  conversion_stats stats;
+
+  ARROW_ASSIGN_OR_RAISE(auto input,
+                        arrow::io::ReadableFile::Open(input_path, &readahead_pool));
+  ARROW_ASSIGN_OR_RAISE(stats.input_bytes, input->GetSize());
+  auto read_options = arrow::csv::ReadOptions::Defaults();
+  read_options.block_size = opts.block_size;
+  ARROW_ASSIGN_OR_RAISE(
+      auto reader, arrow::csv::StreamingReader::Make(
+                       arrow::io::IOContext(&decode_pool), input, read_options,
+                       arrow::csv::ParseOptions::Defaults(),
+                       arrow::csv::ConvertOptions::Defaults()));
+
+  ARROW_ASSIGN_OR_RAISE(auto file, arrow::io::FileOutputStream::Open(output_path));
+  ARROW_ASSIGN_OR_RAISE(auto output,
+                        AsyncOutputStream::Create(file, write_buffer_size, kWriteBuffers,
+                                                  &encode_pool));
+  const int64_t write_buffer_bytes = encode_pool.bytes_allocated();
+  auto properties = parquet::WriterProperties::Builder()
+                        .memory_pool(&encode_pool)
+                        ->compression(opts.compression)
+                        // rows never close a row group, bytes do
+                        ->max_row_group_length(std::numeric_limits<int64_t>::max())
+                        ->build();
+  auto arrow_properties =
+      parquet::ArrowWriterProperties::Builder().set_use_threads(true)->build();
+  ARROW_ASSIGN_OR_RAISE(
+      auto writer, parquet::arrow::FileWriter::Open(*reader->schema(), &encode_pool,
+                                                    output, properties,
+                                                    arrow_properties));
+
+  int64_t row_group_size = 0;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while (true) {
+    ARROW_RETURN_NOT_OK(reader->ReadNext(&batch));
+    if (!batch) break;
+    if (stats.num_row_groups == 0 || row_group_size >= opts.row_group_bytes ||
+        encode_pool.bytes_allocated() - write_buffer_bytes >= row_group_budget / 4) {
+      ARROW_RETURN_NOT_OK(writer->NewBufferedRowGroup());
+      ++stats.num_row_groups;
+      row_group_size = 0;
+    }
+    ARROW_RETURN_NOT_OK(writer->WriteRecordBatch(*batch));
+    ARROW_ASSIGN_OR_RAISE(auto batch_size, arrow::util::ReferencedBufferSize(*batch));
+    row_group_size += batch_size;
+    stats.num_rows += batch->num_rows();
+    batch.reset();  // the encoded copy is all that is kept
+  }
+  ARROW_RETURN_NOT_OK(reader->Close());
+  ARROW_RETURN_NOT_OK(writer->Close());
+  ARROW_RETURN_NOT_OK(output->Close());
+  stats.output_bytes = output->stats().bytes_written;
+
+  std::cout << "pool peaks: readahead " << readahead_pool.max_memory() << "/"
+            << readahead_pool.limit() << ", decode " << decode_pool.max_memory() << "/"
+            << decode_pool.limit() << ", encode " << encode_pool.max_memory() << "/"
+            << encode_pool.limit() << "\n"
+            << "write: " << output->stats() << std::endl;
+  return stats;
+}
+
+int main(int argc, char** argv) {
+  const std::string input_path =
+      argc > 1 ? argv[1] : "../../sample_data/yellow_tripdata_2015-01.csv";
+  const std::string output_path =
+      argc > 2 ? argv[2] : "yellow_tripdata_2015-01.parquet";
+  conversion_options opts;
+  if (argc > 3) opts.row_group_bytes = std::atoll(argv[3]) << 20;
+  if (argc > 4) opts.memory_limit = std::atoll(argv[4]) << 20;
+
+  const auto start = std::chrono::steady_clock::now();
+  auto maybe_stats = csv_to_parquet(input_path, output_path, opts);
+  if (!maybe_stats.ok()) {
+    std::cerr << maybe_stats.status().ToString() << std::endl;
+    return 1;
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  const auto& stats = *maybe_stats;
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  std::cout << stats.num_rows << " rows in " << stats.num_row_groups << " row groups, "
+            << stats.input_bytes << " bytes of CSV to " << stats.output_bytes
+            << " bytes of Parquet in " << elapsed.count() << "s ("
+            << stats.input_bytes / elapsed.count() / (1 << 20) << " MB/s)\n"
+            << "peak RSS " << int64_t{usage.ru_maxrss} * 1024 << " bytes" << std::endl;
+}
@@ -0,0 +1,105 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/io/file.h>
+#include <arrow/memory_pool.h>
+#include <arrow/result.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+// How the chapter 2 readers get at their input. `read` goes through a
+// ReadableFile, so every block is copied out of the page cache into a buffer
+// from the memory pool. `memory_map` maps the file instead: reads become
+// slices of the mapping, the data is only paged in as it is touched and is
+// never copied unless a reader decompresses or decodes it.
+enum class input_mode { read, memory_map };
+
+// The hint passed to the kernel for how the file is about to be read.
+// `sequential` suits readers streaming the file front to back (CSV, JSON),
+// `willneed` readers that jump around but will touch nearly all of it (a full
+// Parquet or ORC read) and asks for the whole file to be read ahead.
+enum class access_hint { normal, sequential, willneed };
+
+// Removes a `--mmap` flag from the arguments, wherever it is, so the
+// positional arguments keep their place whether it was given or not.
+inline input_mode parse_input_mode(int& argc, char** argv) {
+  input_mode mode = input_mode::read;
+  int out = 1;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--mmap") == 0) {
+      mode = input_mode::memory_map;
+    } else {
+      argv[out++] = argv[i];
+    }
+  }
+  argc = out;
+  return mode;
+}
+
+inline const char* input_mode_name(input_mode mode) {
+  return mode == input_mode::memory_map ? "mmap" : "read";
+}
+
+// Opens `path` for reading in the given mode and applies the hint, madvise for
+// a mapping and posix_fadvise for a plain file. `pool` is only used by the
+// read mode, a mapping doesn't allocate for its reads.
+inline arrow::Result<std::shared_ptr<arrow::io::RandomAccessFile>> open_input(
+    const std::string& path, input_mode mode, access_hint hint = access_hint::normal,
+    arrow::MemoryPool* pool = arrow::default_memory_pool()) {
+  if (mode == input_mode::read) {
+    ARROW_ASSIGN_OR_RAISE(auto file, arrow::io::ReadableFile::Open(path, pool));
+    if (hint == access_hint::sequential) {
+      int err = posix_fadvise(file->file_descriptor(), 0, 0, POSIX_FADV_SEQUENTIAL);
+      if (err != 0) {
+        return arrow::Status::IOError("posix_fadvise failed: ", std::strerror(err));
+      }
+    } else if (hint == access_hint::willneed) {
+      ARROW_ASSIGN_OR_RAISE(auto size, file->GetSize());
+      ARROW_RETURN_NOT_OK(file->WillNeed({{0, size}}));
+    }
+    return file;
+  }
+
+  ARROW_ASSIGN_OR_RAISE(
+      auto file, arrow::io::MemoryMappedFile::Open(path, arrow::io::FileMode::READ));
+  ARROW_ASSIGN_OR_RAISE(auto size, file->GetSize());
+  if (size == 0) return file;  // nothing was mapped
+  if (hint == access_hint::sequential) {
+    // Arrow only exposes WILLNEED, the mapping's address comes from a zero
+    // copy read of the whole file which starts on the (page aligned) mapping
+    ARROW_ASSIGN_OR_RAISE(auto whole, file->ReadAt(0, size));
+    if (madvise(const_cast<uint8_t*>(whole->data()), size, MADV_SEQUENTIAL) != 0) {
+      return arrow::Status::IOError("madvise failed: ", std::strerror(errno));
+    }
+  } else if (hint == access_hint::willneed) {
+    ARROW_RETURN_NOT_OK(file->WillNeed({{0, size}}));
+  }
+  return file;
+}
@@ -0,0 +1,186 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <arrow/adapters/orc/adapter.h>
+#include <arrow/api.h>
+#include <arrow/csv/api.h>
+#include <arrow/io/api.h>
+#include <arrow/ipc/api.h>
+#include <parquet/arrow/reader.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "input_file.h"
+
+// Compares reading the taxi sample data through a ReadableFile against memory
+// mapping it, for each of the formats chapter 2 reads. Every measurement runs
+// in its own forked process so the RSS numbers aren't muddied by what the
+// allocator kept from the previous one. Like chapter3/python/memory_usage.py
+// each run reads the file and then takes the mean of total_amount.
+//
+// The RSS growth is split into anonymous memory (buffers the reader
+// allocated) and file backed pages (the parts of a mapping that were touched),
+// the latter are page cache shared with every other process mapping the file.
+// The .arrow and .orc copies are written to the working directory from the
+// Parquet file the first time.
+
+const std::string kCsv = "../../sample_data/yellow_tripdata_2015-01.csv";
+const std::string kParquet = "../../sample_data/yellow_tripdata_2015-01.parquet";
+const std::string kIpc = "yellow_tripdata_2015-01.arrow";
+const std::string kOrc = "yellow_tripdata_2015-01.orc";
+
+struct rss_sample {
+  int64_t anon;
+  int64_t file;
+};
+
+rss_sample current_rss() {
+  // statm is in pages: size resident shared(file backed) ...
+  int64_t size = 0, resident = 0, shared = 0;
+  std::ifstream statm("/proc/self/statm");
+  statm >> size >> resident >> shared;
+  const int64_t page = sysconf(_SC_PAGESIZE);
+  return {(resident - shared) * page, shared * page};
+}
+
+arrow::Result<std::shared_ptr<arrow::Table>> read_table(const std::string& format,
+                                                         input_mode mode) {
+  auto pool = arrow::default_memory_pool();
+  if (format == "csv") {
+    ARROW_ASSIGN_OR_RAISE(auto input, open_input(kCsv, mode, access_hint::sequential));
+    ARROW_ASSIGN_OR_RAISE(auto reader,
+                          arrow::csv::TableReader::Make(
+                              arrow::io::IOContext(pool), input,
+                              arrow::csv::ReadOptions::Defaults(),
+                              arrow::csv::ParseOptions::Defaults(),
+                              arrow::csv::ConvertOptions::Defaults()));
+    return reader->Read();
+  }
+  if (format == "parquet") {
+    ARROW_ASSIGN_OR_RAISE(auto input,
+                          open_input(kParquet, mode, access_hint::willneed));
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    ARROW_RETURN_NOT_OK(parquet::arrow::OpenFile(input, pool, &reader));
+    std::shared_ptr<arrow::Table> table;
+    ARROW_RETURN_NOT_OK(reader->ReadTable(&table));
+    return table;
+  }
+  if (format == "ipc") {
+    // no hint, a mapped IPC file is read without copying so only the pages
+    // of the columns that get used are ever touched
+    ARROW_ASSIGN_OR_RAISE(auto input, open_input(kIpc, mode));
+    ARROW_ASSIGN_OR_RAISE(auto reader,
+                          arrow::ipc::RecordBatchFileReader::Open(input));
+    return reader->ToTable();
+  }
+  ARROW_ASSIGN_OR_RAISE(auto input, open_input(kOrc, mode, access_hint::willneed));
+  ARROW_ASSIGN_OR_RAISE(auto reader,
+                        arrow::adapters::orc::ORCFileReader::Open(input, pool));
+  return reader->Read();
+}
+
+arrow::Status measure(const std::string& format, input_mode mode) {
+  const auto before = current_rss();
+  const auto start = std::chrono::steady_clock::now();
+
+  ARROW_ASSIGN_OR_RAISE(auto table, read_table(format, mode));
+  auto column = table->GetColumnByName("total_amount");
+  if (!column) return arrow::Status::KeyError("no total_amount column");
+  double sum = 0;
+  for (const auto& chunk : column->chunks()) {
+    const auto& values = static_cast<const arrow::DoubleArray&>(*chunk);
+    for (int64_t i = 0; i < values.length(); ++i) {
+      sum += values.Value(i);
+    }
+  }
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  const auto after = current_rss();
+  std::cout << std::left << std::setw(9) << format << std::setw(6)
+            << input_mode_name(mode) << std::right << std::fixed << std::setprecision(3)
+            << std::setw(9) << elapsed.count() << std::setprecision(1) << std::setw(10)
+            << (after.anon - before.anon) / 1048576.0 << std::setw(10)
+            << (after.file - before.file) / 1048576.0 << std::setw(10)
+            << arrow::default_memory_pool()->bytes_allocated() / 1048576.0
+            << std::setprecision(4) << std::setw(12) << sum / column->length()
+            << std::endl;
+  return arrow::Status::OK();
+}
+
+arrow::Status write_copies() {
+  if (access(kIpc.c_str(), F_OK) == 0 && access(kOrc.c_str(), F_OK) == 0) {
+    return arrow::Status::OK();
+  }
+  ARROW_ASSIGN_OR_RAISE(auto table, read_table("parquet", input_mode::read));
+
+  ARROW_ASSIGN_OR_RAISE(auto ipc_out, arrow::io::FileOutputStream::Open(kIpc));
+  ARROW_ASSIGN_OR_RAISE(auto ipc_writer,
+                        arrow::ipc::MakeFileWriter(ipc_out, table->schema()));
+  ARROW_RETURN_NOT_OK(ipc_writer->WriteTable(*table));
+  ARROW_RETURN_NOT_OK(ipc_writer->Close());
+  ARROW_RETURN_NOT_OK(ipc_out->Close());
+
+  ARROW_ASSIGN_OR_RAISE(auto orc_out, arrow::io::FileOutputStream::Open(kOrc));
+  ARROW_ASSIGN_OR_RAISE(auto orc_writer,
+                        arrow::adapters::orc::ORCFileWriter::Open(orc_out.get()));
+  ARROW_RETURN_NOT_OK(orc_writer->Write(*table));
+  ARROW_RETURN_NOT_OK(orc_writer->Close());
+  return orc_out->Close();
+}
+
+// runs `task` in a child process, the parent never touches Arrow so there are
+// no thread pools around to be broken by the fork
+template <typename Task>
+bool in_child(Task&& task) {
+  std::cout.flush();
+  pid_t pid = fork();
+  if (pid == 0) {
+    auto status = task();
+    if (!status.ok()) {
+      std::cerr << status.ToString() << std::endl;
+    }
+    std::cout.flush();
+    _exit(status.ok() ? 0 : 1);
+  }
+  int wstatus = 0;
+  waitpid(pid, &wstatus, 0);
+  return WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0;
+}
+
+int main(int argc, char** argv) {
+  if (!in_child(write_copies)) return 1;
+
+  std::cout << "format   mode   seconds  anon(MB)  file(MB)  pool(MB)  mean total"
+            << std::endl;
+  for (const std::string format : {"csv", "parquet", "ipc", "orc"}) {
+    for (auto mode : {input_mode::read, input_mode::memory_map}) {
+      if (!in_child([&] { return measure(format, mode); })) return 1;
+    }
+  }
+}
@@ -20,12 +20,230 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <arrow/api.h>
 #include <arrow/io/api.h>
+#include <arrow/ipc/api.h>
 #include <arrow/json/api.h>
 #include <arrow/table.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <iostream>
 
+#include "bounded_memory_pool.h"
+
+// CPU time used by the calling thread so far, in nanoseconds
+int64_t thread_cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return int64_t{ts.tv_sec} * 1000000000 + ts.tv_nsec;
+}
+
+// Passes reads through to another stream, adding up the bytes and the wall and
+// CPU time spent in them. The reader calls it from its IO thread.
+class TimedInputStream : public arrow::io::InputStream {
+ public:
+  explicit TimedInputStream(std::shared_ptr<arrow::io::InputStream> raw)
+      : raw_(std::move(raw)) {}
+
+  arrow::Status Close() override { return raw_->Close(); }
+  bool closed() const override { return raw_->closed(); }
+  arrow::Result<int64_t> Tell() const override { return raw_->Tell(); }
+
+  arrow::Result<int64_t> Read(int64_t nbytes, void* out) override {
+    auto start = std::chrono::steady_clock::now();
+    auto cpu_start = thread_cpu_ns();
+    auto result = raw_->Read(nbytes, out);
+    record(start, cpu_start, result.ok() ? *result : 0);
+    return result;
+  }
+
+  arrow::Result<std::shared_ptr<arrow::Buffer>> Read(int64_t nbytes) override {
+    auto start = std::chrono::steady_clock::now();
+    auto cpu_start = thread_cpu_ns();
+    auto result = raw_->Read(nbytes);
+    record(start, cpu_start, result.ok() ? (*result)->size() : 0);
+    return result;
+  }
+
+  int64_t bytes_read() const { return bytes_read_; }
+  std::chrono::nanoseconds read_time() const {
+    return std::chrono::nanoseconds(read_time_ns_);
+  }
+  std::chrono::nanoseconds read_cpu_time() const {
+    return std::chrono::nanoseconds(read_cpu_ns_);
+  }
+
+ private:
+  void record(std::chrono::steady_clock::time_point start, int64_t cpu_start,
+              int64_t nbytes) {
+    bytes_read_ += nbytes;
+    read_cpu_ns_ += thread_cpu_ns() - cpu_start;
+    read_time_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  }
+
+  std::shared_ptr<arrow::io::InputStream> raw_;
+  std::atomic<int64_t> bytes_read_{0};
+  std::atomic<int64_t> read_time_ns_{0};
+  std::atomic<int64_t> read_cpu_ns_{0};
+};
+
+struct ndjson_options {
+  // with a schema nothing is inferred, fields that aren't in it are skipped.
+  // Without one the types are inferred from the first block and then fixed.
+  std::shared_ptr<arrow::Schema> schema;
+  // bytes of input per batch, each block is parsed as its own task
+  int32_t block_size = 1 << 20;
+  // ceiling on the memory held by the reader, split between the raw blocks
+  // read ahead and the parsed batches the same way as stream_csv does in
+  // csv_reader.cc
+  int64_t memory_limit = int64_t{256} << 20;
+  bool use_threads = true;
+};
+
+using batch_consumer =
+    std::function<arrow::Status(const std::shared_ptr<arrow::RecordBatch>&)>;
+
+double cpu_seconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Reads newline delimited JSON one block at a time, handing every batch to the
+// consumer. Prints the throughput of each stage measured against the time it
+// was busy: reading is timed around the file reads (less the time they were
+// held back by the memory limit) and consuming around the callback. Parsing
+// plus conversion runs on several threads at once, so it is charged with the
+// CPU time the process used less the CPU time of the reads and the callbacks.
+// The slowest stage is the one to look at.
+arrow::Status stream_ndjson(const std::string& path, const ndjson_options& opts,
+                            const batch_consumer& consumer) {
+  // same split as stream_csv in csv_reader.cc
+  const int64_t readahead_limit = opts.memory_limit / 4;
+  const int64_t decode_limit = opts.memory_limit - readahead_limit;
+  if (readahead_limit < int64_t{4} * opts.block_size ||
+      decode_limit < int64_t{8} * opts.block_size) {
+    return arrow::Status::Invalid("memory limit of ", opts.memory_limit,
+                                  " bytes is too small for a block size of ",
+                                  opts.block_size);
+  }
+  BoundedMemoryPool readahead_pool(readahead_limit);
+  BoundedMemoryPool pool(decode_limit);
+
+  ARROW_ASSIGN_OR_RAISE(auto file, arrow::io::ReadableFile::Open(path, &readahead_pool));
+  auto input = std::make_shared<TimedInputStream>(file);
+
+  auto read_options = arrow::json::ReadOptions::Defaults();
+  read_options.block_size = opts.block_size;
+  read_options.use_threads = opts.use_threads;
+  auto parse_options = arrow::json::ParseOptions::Defaults();
+  if (opts.schema) {
+    parse_options.explicit_schema = opts.schema;
+    parse_options.unexpected_field_behavior =
+        arrow::json::UnexpectedFieldBehavior::Ignore;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const double cpu_start = cpu_seconds();
+  std::chrono::nanoseconds consume_time{0};
+  int64_t consume_cpu_ns = 0;
+
+  ARROW_ASSIGN_OR_RAISE(auto reader,
+                        arrow::json::StreamingReader::Make(
+                            input, read_options, parse_options,
+                            arrow::io::IOContext(&pool)));
+  int64_t num_rows = 0;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while (true) {
+    ARROW_RETURN_NOT_OK(reader->ReadNext(&batch));
+    if (!batch) break;
+    num_rows += batch->num_rows();
+    auto consume_start = std::chrono::steady_clock::now();
+    auto consume_cpu_start = thread_cpu_ns();
+    ARROW_RETURN_NOT_OK(consumer(batch));
+    consume_cpu_ns += thread_cpu_ns() - consume_cpu_start;
+    consume_time += std::chrono::steady_clock::now() - consume_start;
+    batch.reset();
+  }
+  const int64_t bytes = reader->bytes_processed();
+  ARROW_RETURN_NOT_OK(reader->Close());
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  // a read that waited for the consumer to free memory wasn't reading
+  const double read_secs = std::max(
+      std::chrono::duration<double>(input->read_time() - readahead_pool.stall_time())
+          .count(),
+      1e-9);
+  const double consume_secs = std::chrono::duration<double>(consume_time).count();
+  // CPU time on both sides, the reads' wall time includes waiting on the disk
+  const double read_cpu_secs =
+      std::chrono::duration<double>(input->read_cpu_time()).count();
+  const double decode_secs = std::max(
+      cpu_seconds() - cpu_start - read_cpu_secs - consume_cpu_ns / 1e9, 1e-9);
+  constexpr double MB = 1 << 20;
+
+  std::cout << "streamed " << num_rows << " rows, " << bytes << " bytes in "
+            << elapsed.count() << "s: " << bytes / MB / elapsed.count() << " MB/s, "
+            << num_rows / elapsed.count() << " rows/s\n"
+            << "  read:    " << input->bytes_read() / MB / read_secs << " MB/s ("
+            << read_secs << "s)\n"
+            << "  decode:  " << bytes / MB / decode_secs << " MB/s (" << decode_secs
+            << "s of CPU)\n"
+            << "  consume: " << bytes / MB / consume_secs << " MB/s (" << consume_secs
+            << "s)\n"
+            << "  pool peaks: readahead " << readahead_pool.max_memory() << "/"
+            << readahead_pool.limit() << ", decode " << pool.max_memory() << "/"
+            << pool.limit() << std::endl;
+  return arrow::Status::OK();
+}
+
 int main(int argc, char** argv) {
+  // json_reader --stream file.ndjson [schema] [block_size] [memory_limit]
+  // where the schema is a file holding a serialized Arrow schema, such as the
+  // .schema sidecars csv_reader --schema-cache writes
+  if (argc > 2 && std::strcmp(argv[1], "--stream") == 0) {
+    ndjson_options opts;
+    if (argc > 3) {
+      auto schema_file = arrow::io::ReadableFile::Open(argv[3]);
+      arrow::ipc::DictionaryMemo memo;
+      auto maybe_schema = schema_file.ok()
+                              ? arrow::ipc::ReadSchema(schema_file->get(), &memo)
+                              : schema_file.status();
+      if (!maybe_schema.ok()) {
+        std::cerr << maybe_schema.status().ToString() << std::endl;
+        return 1;
+      }
+      opts.schema = (*maybe_schema)->RemoveMetadata();
+    }
+    if (argc > 4) opts.block_size = std::atoi(argv[4]);
+    if (argc > 5) opts.memory_limit = std::atoll(argv[5]);
+
+    int64_t null_count = 0;
+    auto status = stream_ndjson(argv[2], opts,
+                                [&](const std::shared_ptr<arrow::RecordBatch>& batch) {
+                                  for (const auto& col : batch->columns()) {
+                                    null_count += col->null_count();
+                                  }
+                                  return arrow::Status::OK();
+                                });
+    if (!status.ok()) {
+      std::cerr << status.ToString() << std::endl;
+      return 1;
+    }
+    std::cout << "nulls: " << null_count << std::endl;
+    return 0;
+  }
+
   auto read_options = arrow::json::ReadOptions::Defaults();
   auto parse_options = arrow::json::ParseOptions::Defaults();
 
@@ -0,0 +1,107 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <arrow/csv/api.h>
+#include <arrow/io/api.h>
+#include <arrow/table.h>
+#include <arrow/util/thread_pool.h>
+#include <parquet/arrow/reader.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+
+#include "ndjson_writer.h"
+
+// Writes the taxi data out as newline delimited JSON, then compares the
+// formatting throughput of the NDJSON writer against Arrow's CSV writer on the
+// same table. Both write to a MockOutputStream, which only counts the bytes,
+// so the numbers are for formatting alone and not the disk.
+// Usage: json_writer [repetitions], default 3.
+
+arrow::Result<std::shared_ptr<arrow::Table>> read_parquet(const std::string& path) {
+  ARROW_ASSIGN_OR_RAISE(auto input, arrow::io::ReadableFile::Open(path));
+  std::unique_ptr<parquet::arrow::FileReader> reader;
+  ARROW_RETURN_NOT_OK(
+      parquet::arrow::OpenFile(input, arrow::default_memory_pool(), &reader));
+  std::shared_ptr<arrow::Table> table;
+  ARROW_RETURN_NOT_OK(reader->ReadTable(&table));
+  return table;
+}
+
+arrow::Status time_writer(
+    const std::string& name, int repetitions, int64_t num_rows,
+    const std::function<arrow::Status(arrow::io::OutputStream*)>& write) {
+  double best = 0;
+  int64_t bytes = 0;
+  for (int i = 0; i < repetitions; ++i) {
+    arrow::io::MockOutputStream sink;
+    auto start = std::chrono::steady_clock::now();
+    ARROW_RETURN_NOT_OK(write(&sink));
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (i == 0 || elapsed.count() < best) best = elapsed.count();
+    bytes = sink.GetExtentBytesWritten();
+  }
+  std::cout << name << ": " << bytes << " bytes in " << best << "s, "
+            << bytes / best / (1 << 20) << " MB/s, " << num_rows / best << " rows/s"
+            << std::endl;
+  return arrow::Status::OK();
+}
+
+arrow::Status run(int repetitions) {
+  ARROW_ASSIGN_OR_RAISE(
+      auto table, read_parquet("../../sample_data/yellow_tripdata_2015-01.parquet"));
+
+  ARROW_ASSIGN_OR_RAISE(
+      auto output, arrow::io::FileOutputStream::Open("yellow_tripdata_2015-01.ndjson"));
+  ARROW_RETURN_NOT_OK(write_ndjson(*table, output.get()));
+  ARROW_RETURN_NOT_OK(output->Close());
+
+  std::cout << table->num_rows() << " rows, "
+            << arrow::internal::GetCpuThreadPool()->GetCapacity() << " CPU threads"
+            << std::endl;
+  ARROW_RETURN_NOT_OK(time_writer("ndjson", repetitions, table->num_rows(),
+                                  [&](arrow::io::OutputStream* sink) {
+                                    return write_ndjson(*table, sink);
+                                  }));
+  ndjson_write_options serial;
+  serial.max_in_flight = 1;
+  ARROW_RETURN_NOT_OK(time_writer("ndjson (one batch at a time)", repetitions,
+                                  table->num_rows(), [&](arrow::io::OutputStream* sink) {
+                                    return write_ndjson(*table, sink, serial);
+                                  }));
+  return time_writer("csv", repetitions, table->num_rows(),
+                     [&](arrow::io::OutputStream* sink) {
+                       return arrow::csv::WriteCSV(
+                           *table, arrow::csv::WriteOptions::Defaults(), sink);
+                     });
+}
+
+int main(int argc, char** argv) {
+  const int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 3;
+  auto status = run(repetitions);
+  if (!status.ok()) {
+    std::cerr << status.ToString() << std::endl;
+    return 1;
+  }
+}
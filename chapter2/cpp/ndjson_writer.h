@@ -0,0 +1,323 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <arrow/io/interfaces.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ordered_write.h"
+
+// Writes Arrow data as newline delimited JSON, one object per row. Batches are
+// formatted concurrently on the CPU thread pool and written out in order by
+// write_batches_in_order, like parallel_write in csv_writer.cc. Within a batch
+// each column is formatted on its own by a loop specialized for its type, so
+// there is no per value dispatch, and the rows are then stitched together from
+// the formatted columns. Numbers go through std::to_chars, which gives the
+// shortest text that reads back as the same value.
+//
+// Timestamps and dates are written as strings ("2015-01-01 00:00:05", with
+// the fraction when there is one and a Z for zoned timestamps), which the
+// Arrow JSON reader infers back as timestamps. NaN and infinities have no
+// JSON form and are written as null. Nested types aren't supported.
+
+struct ndjson_write_options {
+  // rows formatted by each task when writing a Table
+  int64_t rows_per_batch = 1 << 16;
+  // formatted batches allowed to wait to be written, 0 means twice the CPU
+  // thread pool capacity
+  int max_in_flight = 0;
+};
+
+namespace ndjson_detail {
+
+// the text of every value of one column back to back, value i being
+// chars[offsets[i], offsets[i + 1])
+struct formatted_column {
+  std::string chars;
+  std::vector<int64_t> offsets;
+};
+
+template <typename T>
+void append_number(std::string* out, T value) {
+  char buf[32];
+  auto result = std::to_chars(buf, buf + sizeof(buf), value);
+  out->append(buf, result.ptr);
+}
+
+// integral floats get a ".0" so the JSON reader infers them back as floats
+template <typename T>
+void append_float(std::string* out, T value) {
+  char buf[32];
+  auto end = std::to_chars(buf, buf + sizeof(buf), value).ptr;
+  out->append(buf, end);
+  if (std::find_if(buf, end, [](char c) { return c == '.' || c == 'e'; }) == end) {
+    out->append(".0");
+  }
+}
+
+inline void append_escaped(std::string* out, std::string_view s) {
+  out->push_back('"');
+  size_t start = 0;
+  for (size_t i = 0; i < s.size(); ++i) {
+    const unsigned char c = s[i];
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    out->append(s.data() + start, i - start);
+    switch (c) {
+      case '"': out->append("\\\""); break;
+      case '\\': out->append("\\\\"); break;
+      case '\n': out->append("\\n"); break;
+      case '\r': out->append("\\r"); break;
+      case '\t': out->append("\\t"); break;
+      default: {
+        static constexpr char kHex[] = "0123456789abcdef";
+        const char escape[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 15]};
+        out->append(escape, sizeof(escape));
+      }
+    }
+    start = i + 1;
+  }
+  out->append(s.data() + start, s.size() - start);
+  out->push_back('"');
+}
+
+inline void append_padded(std::string* out, int64_t value, int width) {
+  char buf[24];
+  auto end = std::to_chars(buf, buf + sizeof(buf), value).ptr;
+  out->append(width - (end - buf), '0');
+  out->append(buf, end);
+}
+
+// days since 1970-01-01 to year/month/day in the proleptic Gregorian calendar
+// (Howard Hinnant's civil_from_days)
+inline void append_date(std::string* out, int64_t days) {
+  days += 719468;
+  const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const int64_t doe = days - era * 146097;
+  const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const int64_t mp = (5 * doy + 2) / 153;
+  const int64_t day = doy - (153 * mp + 2) / 5 + 1;
+  const int64_t month = mp < 10 ? mp + 3 : mp - 9;
+  const int64_t year = yoe + era * 400 + (month <= 2);
+  append_padded(out, year, 4);
+  out->push_back('-');
+  append_padded(out, month, 2);
+  out->push_back('-');
+  append_padded(out, day, 2);
+}
+
+// the loop every column type goes through, `format` appends one valid value
+template <typename ArrayType, typename Format>
+void format_values(const ArrayType& array, formatted_column* out, Format&& format) {
+  const int64_t length = array.length();
+  out->offsets.resize(length + 1);
+  out->offsets[0] = 0;
+  const bool has_nulls = array.null_count() > 0;
+  for (int64_t i = 0; i < length; ++i) {
+    if (has_nulls && array.IsNull(i)) {
+      out->chars.append("null");
+    } else {
+      format(array, i, &out->chars);
+    }
+    out->offsets[i + 1] = out->chars.size();
+  }
+}
+
+template <typename ArrowType>
+void format_integers(const arrow::Array& array, formatted_column* out) {
+  format_values(static_cast<const arrow::NumericArray<ArrowType>&>(array), out,
+                [](const auto& a, int64_t i, std::string* s) {
+                  append_number(s, a.Value(i));
+                });
+}
+
+template <typename ArrowType>
+void format_floats(const arrow::Array& array, formatted_column* out) {
+  format_values(static_cast<const arrow::NumericArray<ArrowType>&>(array), out,
+                [](const auto& a, int64_t i, std::string* s) {
+                  const auto v = a.Value(i);
+                  if (std::isfinite(v)) {
+                    append_float(s, v);
+                  } else {
+                    s->append("null");
+                  }
+                });
+}
+
+template <typename ArrayType>
+void format_strings(const arrow::Array& array, formatted_column* out) {
+  format_values(static_cast<const ArrayType&>(array), out,
+                [](const auto& a, int64_t i, std::string* s) {
+                  append_escaped(s, a.GetView(i));
+                });
+}
+
+inline void format_timestamps(const arrow::Array& array, formatted_column* out) {
+  const auto& type = static_cast<const arrow::TimestampType&>(*array.type());
+  int digits = 0;
+  int64_t per_second = 1;
+  switch (type.unit()) {
+    case arrow::TimeUnit::SECOND: break;
+    case arrow::TimeUnit::MILLI: digits = 3, per_second = 1000; break;
+    case arrow::TimeUnit::MICRO: digits = 6, per_second = 1000000; break;
+    case arrow::TimeUnit::NANO: digits = 9, per_second = 1000000000; break;
+  }
+  const bool zoned = !type.timezone().empty();
+  format_values(static_cast<const arrow::TimestampArray&>(array), out,
+                [&](const auto& a, int64_t i, std::string* s) {
+                  const int64_t value = a.Value(i);
+                  // floor division so times before 1970 come out right
+                  int64_t secs = value / per_second;
+                  int64_t fraction = value % per_second;
+                  if (fraction < 0) fraction += per_second, --secs;
+                  int64_t days = secs / 86400;
+                  int64_t time = secs % 86400;
+                  if (time < 0) time += 86400, --days;
+
+                  s->push_back('"');
+                  append_date(s, days);
+                  s->push_back(' ');
+                  append_padded(s, time / 3600, 2);
+                  s->push_back(':');
+                  append_padded(s, time / 60 % 60, 2);
+                  s->push_back(':');
+                  append_padded(s, time % 60, 2);
+                  if (fraction != 0) {
+                    s->push_back('.');
+                    append_padded(s, fraction, digits);
+                  }
+                  if (zoned) s->push_back('Z');
+                  s->push_back('"');
+                });
+}
+
+inline arrow::Status format_column(const arrow::Array& array, formatted_column* out) {
+  using arrow::Type;
+  switch (array.type_id()) {
+    case Type::NA:
+      out->offsets.resize(array.length() + 1);
+      for (int64_t i = 0; i <= array.length(); ++i) {
+        out->offsets[i] = 4 * i;
+        if (i < array.length()) out->chars.append("null");
+      }
+      return arrow::Status::OK();
+    case Type::BOOL:
+      format_values(static_cast<const arrow::BooleanArray&>(array), out,
+                    [](const auto& a, int64_t i, std::string* s) {
+                      s->append(a.Value(i) ? "true" : "false");
+                    });
+      break;
+    case Type::INT8: format_integers<arrow::Int8Type>(array, out); break;
+    case Type::INT16: format_integers<arrow::Int16Type>(array, out); break;
+    case Type::INT32: format_integers<arrow::Int32Type>(array, out); break;
+    case Type::INT64: format_integers<arrow::Int64Type>(array, out); break;
+    case Type::UINT8: format_integers<arrow::UInt8Type>(array, out); break;
+    case Type::UINT16: format_integers<arrow::UInt16Type>(array, out); break;
+    case Type::UINT32: format_integers<arrow::UInt32Type>(array, out); break;
+    case Type::UINT64: format_integers<arrow::UInt64Type>(array, out); break;
+    case Type::FLOAT: format_floats<arrow::FloatType>(array, out); break;
+    case Type::DOUBLE: format_floats<arrow::DoubleType>(array, out); break;
+    case Type::STRING: format_strings<arrow::StringArray>(array, out); break;
+    case Type::LARGE_STRING: format_strings<arrow::LargeStringArray>(array, out); break;
+    case Type::TIMESTAMP: format_timestamps(array, out); break;
+    case Type::DATE32:
+      format_values(static_cast<const arrow::Date32Array&>(array), out,
+                    [](const auto& a, int64_t i, std::string* s) {
+                      s->push_back('"');
+                      append_date(s, a.Value(i));
+                      s->push_back('"');
+                    });
+      break;
+    default:
+      return arrow::Status::NotImplemented("writing ", array.type()->ToString(),
+                                           " as JSON");
+  }
+  return arrow::Status::OK();
+}
+
+}  // namespace ndjson_detail
+
+// Formats one batch as NDJSON text, one line per row.
+inline arrow::Result<std::shared_ptr<arrow::Buffer>> format_ndjson(
+    const arrow::RecordBatch& batch,
+    arrow::MemoryPool* pool = arrow::default_memory_pool()) {
+  namespace detail = ndjson_detail;
+  const int ncols = batch.num_columns();
+
+  // `{"name":` before the first value and `,"name":` before the others
+  std::vector<std::string> keys(ncols);
+  std::vector<detail::formatted_column> columns(ncols);
+  int64_t size = 0;
+  for (int c = 0; c < ncols; ++c) {
+    keys[c].push_back(c == 0 ? '{' : ',');
+    detail::append_escaped(&keys[c], batch.schema()->field(c)->name());
+    keys[c].push_back(':');
+    ARROW_RETURN_NOT_OK(detail::format_column(*batch.column(c), &columns[c]));
+    size += columns[c].chars.size() + keys[c].size() * batch.num_rows();
+  }
+  size += batch.num_rows() * 2;  // "}\n", or "{}\n" without columns
+  if (ncols == 0) size += batch.num_rows();
+
+  ARROW_ASSIGN_OR_RAISE(auto buffer, arrow::AllocateBuffer(size, pool));
+  auto out = reinterpret_cast<char*>(buffer->mutable_data());
+  for (int64_t row = 0; row < batch.num_rows(); ++row) {
+    if (ncols == 0) *out++ = '{';
+    for (int c = 0; c < ncols; ++c) {
+      std::memcpy(out, keys[c].data(), keys[c].size());
+      out += keys[c].size();
+      const auto begin = columns[c].offsets[row];
+      const auto length = columns[c].offsets[row + 1] - begin;
+      std::memcpy(out, columns[c].chars.data() + begin, length);
+      out += length;
+    }
+    *out++ = '}';
+    *out++ = '\n';
+  }
+  return std::shared_ptr<arrow::Buffer>(std::move(buffer));
+}
+
+// Writes every batch from the reader as NDJSON, formatting several batches at
+// once but writing them in the order they were read.
+inline arrow::Status write_ndjson(arrow::RecordBatchReader* reader,
+                                  arrow::io::OutputStream* output,
+                                  const ndjson_write_options& options = {}) {
+  auto format = [](const arrow::RecordBatch& batch, int64_t) {
+    return format_ndjson(batch);
+  };
+  return write_batches_in_order(reader, output, format, options.max_in_flight).status();
+}
+
+inline arrow::Status write_ndjson(const arrow::Table& table,
+                                  arrow::io::OutputStream* output,
+                                  const ndjson_write_options& options = {}) {
+  arrow::TableBatchReader reader{table};
+  reader.set_chunksize(options.rows_per_batch);
+  return write_ndjson(&reader, output, options);
+}
@@ -0,0 +1,142 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <arrow/adapters/orc/adapter.h>
+#include <arrow/io/api.h>
+#include <arrow/table.h>
+#include <arrow/util/byte_size.h>
+#include <arrow/util/compression.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Writes train.orc with every combination of stripe size, batch size, codec
+// and dictionary threshold, then reads a few columns of each file back.
+// Reports the write throughput (in bytes of Arrow data), the file size and the
+// projected read time, so the storage/CPU trade-off can be picked per export.
+// Usage: orc_write_bench [col,col,...], defaults to the first three columns of
+// train.orc.
+
+using arrow::adapters::orc::ORCFileReader;
+using arrow::adapters::orc::ORCFileWriter;
+
+struct bench_result {
+  double write_secs;
+  int64_t file_size;
+  double read_secs;
+};
+
+arrow::Result<bench_result> run(const arrow::Table& table,
+                                const arrow::adapters::orc::WriteOptions& options,
+                                const std::vector<std::string>& columns) {
+  const std::string path = "train_bench.orc";
+  bench_result result;
+
+  auto start = std::chrono::steady_clock::now();
+  ARROW_ASSIGN_OR_RAISE(auto output, arrow::io::FileOutputStream::Open(path));
+  ARROW_ASSIGN_OR_RAISE(auto writer, ORCFileWriter::Open(output.get(), options));
+  ARROW_RETURN_NOT_OK(writer->Write(table));
+  ARROW_RETURN_NOT_OK(writer->Close());
+  ARROW_RETURN_NOT_OK(output->Close());
+  result.write_secs =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // the reads are short, keep the best of a few
+  for (int i = 0; i < 3; ++i) {
+    start = std::chrono::steady_clock::now();
+    ARROW_ASSIGN_OR_RAISE(auto input, arrow::io::ReadableFile::Open(path));
+    ARROW_ASSIGN_OR_RAISE(result.file_size, input->GetSize());
+    ARROW_ASSIGN_OR_RAISE(auto reader,
+                          ORCFileReader::Open(input, arrow::default_memory_pool()));
+    ARROW_ASSIGN_OR_RAISE(auto projected, reader->Read(columns));
+    const double secs =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.read_secs = i == 0 ? secs : std::min(result.read_secs, secs);
+  }
+  return result;
+}
+
+int main(int argc, char** argv) {
+  auto input = arrow::io::ReadableFile::Open("../../sample_data/train.orc").ValueOrDie();
+  auto table = ORCFileReader::Open(input, arrow::default_memory_pool())
+                   .ValueOrDie()
+                   ->Read()
+                   .ValueOrDie();
+
+  std::vector<std::string> columns;
+  if (argc > 1) {
+    std::stringstream list(argv[1]);
+    for (std::string col; std::getline(list, col, ',');) columns.push_back(col);
+  } else {
+    const int num_columns = std::min(3, table->num_columns());
+    for (int i = 0; i < num_columns; ++i) columns.push_back(table->field(i)->name());
+  }
+  // checked once here rather than failing every configuration below
+  for (const auto& col : columns) {
+    if (table->schema()->GetFieldIndex(col) == -1) {
+      std::cerr << "no column named '" << col << "' in train.orc, it has:";
+      for (const auto& name : table->schema()->field_names()) std::cerr << " " << name;
+      std::cerr << std::endl;
+      return 1;
+    }
+  }
+  const double table_mb = arrow::util::TotalBufferSize(*table) / double(1 << 20);
+  std::cout << table->num_rows() << " rows, " << table_mb << " MB in memory\n\n"
+            << "stripe  batch  codec         dict  write MB/s   file MB  read "
+            << columns.size() << " cols (s)" << std::endl;
+
+  for (int64_t stripe_size : {int64_t{8} << 20, int64_t{64} << 20}) {
+    for (int64_t batch_size : {1024, 65536}) {
+      for (auto codec : {arrow::Compression::UNCOMPRESSED, arrow::Compression::SNAPPY,
+                         arrow::Compression::LZ4, arrow::Compression::ZSTD,
+                         arrow::Compression::GZIP}) {
+        for (double dictionary : {0.0, 0.8}) {
+          arrow::adapters::orc::WriteOptions options;
+          options.stripe_size = stripe_size;
+          options.batch_size = batch_size;
+          options.compression = codec;
+          options.dictionary_key_size_threshold = dictionary;
+
+          std::cout << std::left << std::setw(3) << (stripe_size >> 20) << "MB  "
+                    << std::setw(7) << batch_size << std::setw(14)
+                    << arrow::util::Codec::GetCodecAsString(codec) << std::setw(4)
+                    << dictionary;
+          auto result = run(*table, options, columns);
+          if (!result.ok()) {
+            std::cout << "  " << result.status().ToString() << std::endl;
+            continue;
+          }
+          std::cout << std::right << std::fixed << std::setprecision(1) << std::setw(12)
+                    << table_mb / result->write_secs << std::setw(10)
+                    << result->file_size / double(1 << 20) << std::setprecision(4)
+                    << std::setw(16) << result->read_secs << std::defaultfloat
+                    << std::endl;
+        }
+      }
+    }
+  }
+}
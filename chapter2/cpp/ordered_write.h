@@ -0,0 +1,78 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <arrow/io/interfaces.h>
+#include <arrow/util/future.h>
+#include <arrow/util/thread_pool.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+// Turns one batch into the bytes to write for it. `index` counts the batches
+// from 0 in the order they were read.
+using batch_formatter = std::function<arrow::Result<std::shared_ptr<arrow::Buffer>>(
+    const arrow::RecordBatch& batch, int64_t index)>;
+
+// Formats the batches from `reader` concurrently on the CPU thread pool, each
+// into its own buffer, and writes the buffers to `output` in the order the
+// batches were read. At most `max_in_flight` formatted batches wait for their
+// turn, which is what caps the memory, 0 means twice the CPU thread pool
+// capacity. Returns how many batches were written.
+inline arrow::Result<int64_t> write_batches_in_order(arrow::RecordBatchReader* reader,
+                                                     arrow::io::OutputStream* output,
+                                                     batch_formatter format,
+                                                     int max_in_flight = 0) {
+  auto* executor = arrow::internal::GetCpuThreadPool();
+  const size_t limit = max_in_flight > 0 ? max_in_flight : 2 * executor->GetCapacity();
+
+  // futures are queued in batch order, the front is always the next to write
+  std::deque<arrow::Future<std::shared_ptr<arrow::Buffer>>> in_flight;
+  auto write_front = [&]() -> arrow::Status {
+    ARROW_ASSIGN_OR_RAISE(auto buffer, in_flight.front().result());
+    in_flight.pop_front();
+    return output->Write(buffer);
+  };
+
+  int64_t index = 0;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while (true) {
+    ARROW_RETURN_NOT_OK(reader->ReadNext(&batch));
+    if (!batch) break;
+    if (in_flight.size() == limit) {
+      ARROW_RETURN_NOT_OK(write_front());
+    }
+    // the task keeps its own copies, it may still run after an early return
+    ARROW_ASSIGN_OR_RAISE(auto future, executor->Submit([format, batch, index] {
+                            return format(*batch, index);
+                          }));
+    in_flight.push_back(std::move(future));
+    ++index;
+  }
+  while (!in_flight.empty()) {
+    ARROW_RETURN_NOT_OK(write_front());
+  }
+  return index;
+}
@@ -0,0 +1,506 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <arrow/compute/api.h>
+#include <parquet/arrow/schema.h>
+#include <parquet/bloom_filter.h>
+#include <parquet/bloom_filter_reader.h>
+#include <parquet/column_reader.h>
+#include <parquet/exception.h>
+#include <parquet/file_reader.h>
+#include <parquet/page_index.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "parquet_projected_reader.h"
+#include "parquet_row_group_filter.h"
+
+// Point lookups, the rows where one column equals a key, against files written
+// with enable_lookup_indexes() (see parquet_tuned_writer.h). Each mode does
+// the work of the one before it and then some, so they can be compared.
+enum class lookup_mode {
+  // read the columns of every row group and filter the rows
+  full_scan,
+  // skip the row groups whose statistics or bloom filter rule the key out
+  row_group_pruned,
+  // in the remaining row groups decode only the pages of the key column whose
+  // column index allows the key, then only the pages of the other columns
+  // that hold matching rows
+  page_pruned,
+};
+
+struct lookup_stats {
+  int row_groups = 0;
+  int row_groups_read = 0;
+  // row groups the statistics let through but the bloom filter didn't
+  int bloom_filter_pruned = 0;
+  // data pages of the columns read in the row groups read, from the offset
+  // index so only counted when the file has one
+  int64_t pages = 0;
+  int64_t pages_read = 0;
+  int64_t rows = 0;
+};
+
+// the Arrow type a parquet physical type decodes to as is
+template <typename DType>
+struct physical_arrow_type;
+template <>
+struct physical_arrow_type<parquet::BooleanType> {
+  using type = arrow::BooleanType;
+};
+template <>
+struct physical_arrow_type<parquet::Int32Type> {
+  using type = arrow::Int32Type;
+};
+template <>
+struct physical_arrow_type<parquet::Int64Type> {
+  using type = arrow::Int64Type;
+};
+template <>
+struct physical_arrow_type<parquet::FloatType> {
+  using type = arrow::FloatType;
+};
+template <>
+struct physical_arrow_type<parquet::DoubleType> {
+  using type = arrow::DoubleType;
+};
+template <>
+struct physical_arrow_type<parquet::ByteArrayType> {
+  using type = arrow::BinaryType;
+};
+
+inline std::string_view byte_view(const parquet::ByteArray& value) {
+  return {reinterpret_cast<const char*>(value.ptr), value.len};
+}
+
+template <typename T>
+bool value_less(const T& a, const T& b) {
+  return a < b;
+}
+inline bool value_less(const parquet::ByteArray& a, const parquet::ByteArray& b) {
+  return byte_view(a) < byte_view(b);
+}
+
+template <typename T>
+bool value_equal(const T& a, const T& b) {
+  return a == b;
+}
+inline bool value_equal(const parquet::ByteArray& a, const parquet::ByteArray& b) {
+  return byte_view(a) == byte_view(b);
+}
+
+// Calls fn with a default constructed parquet DType for the physical type.
+template <typename Fn>
+auto visit_physical_type(parquet::Type::type type, Fn&& fn) -> decltype(fn(
+    parquet::Int32Type{})) {
+  switch (type) {
+    case parquet::Type::BOOLEAN:
+      return fn(parquet::BooleanType{});
+    case parquet::Type::INT32:
+      return fn(parquet::Int32Type{});
+    case parquet::Type::INT64:
+      return fn(parquet::Int64Type{});
+    case parquet::Type::FLOAT:
+      return fn(parquet::FloatType{});
+    case parquet::Type::DOUBLE:
+      return fn(parquet::DoubleType{});
+    case parquet::Type::BYTE_ARRAY:
+      return fn(parquet::ByteArrayType{});
+    default:
+      return arrow::Status::NotImplemented("lookups on ",
+                                           parquet::TypeToString(type), " columns");
+  }
+}
+
+// Reads the values of a flat column in one row group, skipping the data pages
+// whose `keep` entry is false before they are decompressed or decoded. `pages`
+// is the column's offset index, nothing is skipped without one. `visit` gets
+// the row number and a pointer to the value, or nullptr for a null, which is
+// only valid for the duration of the call.
+template <typename DType, typename Visit>
+arrow::Status scan_pages(parquet::RowGroupReader* row_group, int column,
+                         const std::vector<parquet::PageLocation>& pages,
+                         const std::vector<bool>& keep, Visit&& visit) {
+  using T = typename DType::c_type;
+  const auto* descr = row_group->metadata()->schema()->Column(column);
+  if (descr->max_repetition_level() > 0) {
+    return arrow::Status::NotImplemented("lookups on repeated column ", descr->name());
+  }
+
+  // a read never goes past the end of the current page, so the row number
+  // only needs resetting when the reader moves on to the next kept page
+  int64_t row = 0;
+  size_t next_page = 0;
+  auto pager = row_group->GetColumnPageReader(column);
+  if (!pages.empty()) {
+    pager->set_data_page_filter([&](const parquet::DataPageStats&) {
+      const size_t page = next_page++;
+      if (page < keep.size() && !keep[page]) return true;
+      if (page < pages.size()) row = pages[page].first_row_index;
+      return false;
+    });
+  }
+  auto reader = std::static_pointer_cast<parquet::TypedColumnReader<DType>>(
+      parquet::ColumnReader::Make(descr, std::move(pager)));
+
+  constexpr int64_t batch_size = 4096;
+  const int16_t max_def_level = descr->max_definition_level();
+  std::vector<int16_t> def_levels(batch_size);
+  // not a vector, vector<bool> has no contiguous storage to decode into
+  std::unique_ptr<T[]> values(new T[batch_size]);
+  while (reader->HasNext()) {
+    int64_t values_read = 0;
+    const int64_t levels_read = reader->ReadBatch(batch_size, def_levels.data(), nullptr,
+                                                  values.get(), &values_read);
+    for (int64_t i = 0, v = 0; i < levels_read; ++i, ++row) {
+      const bool valid = max_def_level == 0 || def_levels[i] == max_def_level;
+      ARROW_RETURN_NOT_OK(visit(row, valid ? &values[v++] : nullptr));
+    }
+  }
+  return arrow::Status::OK();
+}
+
+inline std::vector<parquet::PageLocation> page_locations(
+    parquet::RowGroupPageIndexReader* page_index, int column) {
+  if (!page_index) return {};
+  auto offset_index = page_index->GetOffsetIndex(column);
+  if (!offset_index) return {};
+  return offset_index->page_locations();
+}
+
+// The rows of one row group holding `key`, decoding only the pages whose
+// column index min/max allows it.
+template <typename DType>
+arrow::Result<std::vector<int64_t>> matching_rows(
+    parquet::RowGroupReader* row_group, parquet::RowGroupPageIndexReader* page_index,
+    int column, const typename DType::c_type& key, lookup_stats* stats) {
+  using T = typename DType::c_type;
+  const auto pages = page_locations(page_index, column);
+  std::vector<bool> keep(pages.size(), true);
+  std::shared_ptr<parquet::TypedColumnIndex<DType>> column_index;
+  if (page_index) {
+    column_index = std::dynamic_pointer_cast<parquet::TypedColumnIndex<DType>>(
+        page_index->GetColumnIndex(column));
+  }
+  // unsigned integers keep their bits in the signed physical type but their
+  // min/max follow the unsigned order
+  const auto order = row_group->metadata()->schema()->Column(column)->sort_order();
+  auto less = [&](const T& a, const T& b) {
+    if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+      if (order == parquet::SortOrder::UNSIGNED) {
+        using U = std::make_unsigned_t<T>;
+        return static_cast<U>(a) < static_cast<U>(b);
+      }
+    }
+    return value_less(a, b);
+  };
+  if (column_index && column_index->min_values().size() == pages.size() &&
+      order != parquet::SortOrder::UNKNOWN) {
+    const auto& min = column_index->min_values();
+    const auto& max = column_index->max_values();
+    const auto& null_pages = column_index->null_pages();
+    for (size_t i = 0; i < pages.size(); ++i) {
+      keep[i] = !null_pages[i] && !less(key, min[i]) && !less(max[i], key);
+    }
+  }
+  stats->pages += pages.size();
+  stats->pages_read += std::count(keep.begin(), keep.end(), true);
+
+  std::vector<int64_t> rows;
+  ARROW_RETURN_NOT_OK(
+      scan_pages<DType>(row_group, column, pages, keep, [&](int64_t row, const T* value) {
+        if (value && value_equal(*value, key)) rows.push_back(row);
+        return arrow::Status::OK();
+      }));
+  return rows;
+}
+
+// The values of one column at `rows` (ascending) of a row group, decoding
+// only the pages that hold them.
+template <typename DType>
+arrow::Result<std::shared_ptr<arrow::Array>> gather_rows(
+    parquet::RowGroupReader* row_group, parquet::RowGroupPageIndexReader* page_index,
+    int column, const std::vector<int64_t>& rows, arrow::MemoryPool* pool,
+    lookup_stats* stats) {
+  using T = typename DType::c_type;
+  const auto pages = page_locations(page_index, column);
+  std::vector<bool> keep(pages.size());
+  for (size_t i = 0; i < pages.size(); ++i) {
+    const int64_t end = i + 1 < pages.size() ? pages[i + 1].first_row_index
+                                             : row_group->metadata()->num_rows();
+    auto first = std::lower_bound(rows.begin(), rows.end(), pages[i].first_row_index);
+    keep[i] = first != rows.end() && *first < end;
+  }
+  stats->pages += pages.size();
+  stats->pages_read += std::count(keep.begin(), keep.end(), true);
+
+  typename arrow::TypeTraits<typename physical_arrow_type<DType>::type>::BuilderType
+      builder(pool);
+  ARROW_RETURN_NOT_OK(builder.Reserve(rows.size()));
+  size_t next = 0;
+  ARROW_RETURN_NOT_OK(
+      scan_pages<DType>(row_group, column, pages, keep, [&](int64_t row, const T* value) {
+        if (next == rows.size() || rows[next] != row) return arrow::Status::OK();
+        ++next;
+        if (!value) return builder.AppendNull();
+        if constexpr (std::is_same_v<DType, parquet::ByteArrayType>) {
+          return builder.Append(value->ptr, value->len);
+        } else {
+          return builder.Append(*value);
+        }
+      }));
+  return builder.Finish();
+}
+
+// int64 to timestamp or binary to string is a matter of relabeling the
+// buffers, int32 to int16 say takes a cast
+inline arrow::Result<std::shared_ptr<arrow::Array>> as_field_type(
+    const std::shared_ptr<arrow::Array>& array,
+    const std::shared_ptr<arrow::DataType>& type) {
+  if (array->type()->Equals(*type)) return array;
+  auto view = array->View(type);
+  if (view.ok()) return view;
+  return arrow::compute::Cast(*array, type);
+}
+
+// The key, already of the column's Arrow type, as the physical value the column
+// holds. `stored_type` is the type the column reads as without the Arrow schema
+// saved in the file, which is how the value is actually stored: timestamp[s]
+// is stored as milliseconds and date64 as days for instance. The casts are
+// safe ones, so a key the column can't hold fails instead of being truncated.
+template <typename DType>
+arrow::Result<typename DType::c_type> physical_key(
+    const std::shared_ptr<arrow::Scalar>& key,
+    const std::shared_ptr<arrow::DataType>& stored_type,
+    std::shared_ptr<arrow::Scalar>* holder) {
+  using ArrowType = typename physical_arrow_type<DType>::type;
+  using ScalarType = typename arrow::TypeTraits<ArrowType>::ScalarType;
+  const auto physical_type = arrow::TypeTraits<ArrowType>::type_singleton();
+  if (!key->is_valid) return arrow::Status::Invalid("lookups of a null key");
+
+  ARROW_ASSIGN_OR_RAISE(auto stored, arrow::compute::Cast(key, stored_type));
+  ARROW_ASSIGN_OR_RAISE(auto array, arrow::MakeArrayFromScalar(*stored.scalar(), 1));
+  // same width storage (timestamps, dates, unsigned, strings) is only relabeled,
+  // the integers narrower than int32 are widened the way parquet stores them
+  auto physical = array->View(physical_type);
+  if (!physical.ok()) {
+    if (!arrow::is_integer(stored_type->id())) {
+      return arrow::Status::NotImplemented("lookups on ", key->type->ToString(),
+                                           " columns stored as ",
+                                           physical_type->ToString());
+    }
+    ARROW_ASSIGN_OR_RAISE(physical, arrow::compute::Cast(*array, physical_type));
+  }
+  ARROW_ASSIGN_OR_RAISE(*holder, (*physical)->GetScalar(0));
+  const auto& scalar = static_cast<const ScalarType&>(**holder);
+  if constexpr (std::is_same_v<DType, parquet::ByteArrayType>) {
+    return parquet::ByteArray(static_cast<uint32_t>(scalar.value->size()),
+                              scalar.value->data());
+  } else {
+    return scalar.value;
+  }
+}
+
+template <typename DType>
+arrow::Result<std::shared_ptr<arrow::Table>> lookup_parquet_typed(
+    std::shared_ptr<arrow::io::RandomAccessFile> input, parquet::ParquetFileReader* file,
+    const parquet::arrow::SchemaManifest& manifest, int key_field,
+    const std::shared_ptr<arrow::Scalar>& key,
+    const std::shared_ptr<arrow::DataType>& stored_type, lookup_mode mode,
+    const std::vector<int>& fields, arrow::MemoryPool* pool, lookup_stats* stats) {
+  namespace cp = arrow::compute;
+  const auto metadata = file->metadata();
+  const int key_column = manifest.schema_fields[key_field].column_index;
+  const auto& key_name = manifest.schema_fields[key_field].field->name();
+  // a timestamp[us] key for a timestamp[ms] column and the like, every mode
+  // compares the key as a value of the column's type
+  ARROW_ASSIGN_OR_RAISE(auto typed_key,
+                        cp::Cast(key, manifest.schema_fields[key_field].field->type()));
+  std::shared_ptr<arrow::Scalar> holder;
+  ARROW_ASSIGN_OR_RAISE(auto physical,
+                        physical_key<DType>(typed_key.scalar(), stored_type, &holder));
+
+  arrow::FieldVector output_fields;
+  std::vector<std::string> names;
+  for (int i : fields) {
+    output_fields.push_back(manifest.schema_fields[i].field);
+    names.push_back(output_fields.back()->name());
+  }
+  const auto schema = arrow::schema(output_fields);
+  const auto filter = cp::equal(cp::field_ref(key_name), cp::literal(typed_key));
+
+  std::vector<int> row_groups;
+  if (mode == lookup_mode::full_scan) {
+    for (int i = 0; i < metadata->num_row_groups(); ++i) row_groups.push_back(i);
+  } else {
+    ARROW_ASSIGN_OR_RAISE(row_groups, prune_row_groups(*metadata, filter));
+    // what is left the bloom filters can still rule out, if the file has them
+    std::vector<int> kept;
+    for (int i : row_groups) {
+      // booleans never get a bloom filter
+      if constexpr (!std::is_same_v<DType, parquet::BooleanType>) {
+        std::unique_ptr<parquet::BloomFilter> bloom_filter;
+        PARQUET_CATCH_NOT_OK(bloom_filter = file->GetBloomFilterReader()
+                                                .RowGroup(i)
+                                                ->GetColumnBloomFilter(key_column));
+        uint64_t hash = 0;
+        if constexpr (std::is_same_v<DType, parquet::ByteArrayType>) {
+          if (bloom_filter) hash = bloom_filter->Hash(&physical);
+        } else {
+          if (bloom_filter) hash = bloom_filter->Hash(physical);
+        }
+        if (bloom_filter && !bloom_filter->FindHash(hash)) {
+          ++stats->bloom_filter_pruned;
+          continue;
+        }
+      }
+      kept.push_back(i);
+    }
+    row_groups = std::move(kept);
+  }
+  stats->row_groups += metadata->num_row_groups();
+  stats->row_groups_read += row_groups.size();
+  if (row_groups.empty()) return arrow::Table::MakeEmpty(schema, pool);
+
+  std::shared_ptr<parquet::PageIndexReader> page_index;
+  PARQUET_CATCH_NOT_OK(page_index = file->GetPageIndexReader());
+
+  if (mode != lookup_mode::page_pruned) {
+    // every page of the columns read gets decoded
+    std::vector<int> columns{key_column};
+    for (int i : fields) {
+      if (i != key_field) columns.push_back(manifest.schema_fields[i].column_index);
+    }
+    for (int i : row_groups) {
+      std::shared_ptr<parquet::RowGroupPageIndexReader> row_group_index;
+      if (page_index) PARQUET_CATCH_NOT_OK(row_group_index = page_index->RowGroup(i));
+      for (int c : columns) {
+        const auto pages = page_locations(row_group_index.get(), c).size();
+        stats->pages += pages;
+        stats->pages_read += pages;
+      }
+    }
+
+    parquet_read_options options;
+    options.columns = names;
+    options.columns.push_back(key_name);
+    options.row_groups = row_groups;
+    ARROW_ASSIGN_OR_RAISE(auto table, read_parquet_projected(input, options, pool));
+    ARROW_ASSIGN_OR_RAISE(table, filter_table(table, filter, pool));
+    stats->rows += table->num_rows();
+    std::vector<int> indices;
+    for (const auto& name : names) {
+      indices.push_back(table->schema()->GetFieldIndex(name));
+    }
+    return table->SelectColumns(indices);
+  }
+
+  arrow::RecordBatchVector batches;
+  BEGIN_PARQUET_CATCH_EXCEPTIONS
+  for (int i : row_groups) {
+    auto row_group = file->RowGroup(i);
+    auto row_group_index = page_index ? page_index->RowGroup(i) : nullptr;
+    ARROW_ASSIGN_OR_RAISE(auto rows,
+                          matching_rows<DType>(row_group.get(), row_group_index.get(),
+                                               key_column, physical, stats));
+    if (rows.empty()) continue;
+
+    arrow::ArrayVector columns;
+    for (int f : fields) {
+      const auto& field = manifest.schema_fields[f];
+      if (!field.is_leaf()) {
+        return arrow::Status::NotImplemented("page pruned lookups of nested column ",
+                                             field.field->name());
+      }
+      const auto* descr = metadata->schema()->Column(field.column_index);
+      ARROW_ASSIGN_OR_RAISE(
+          auto array, visit_physical_type(descr->physical_type(), [&](auto type) {
+            using T = decltype(type);
+            return gather_rows<T>(row_group.get(), row_group_index.get(),
+                                  field.column_index, rows, pool, stats);
+          }));
+      ARROW_ASSIGN_OR_RAISE(array, as_field_type(array, field.field->type()));
+      columns.push_back(std::move(array));
+    }
+    stats->rows += rows.size();
+    batches.push_back(arrow::RecordBatch::Make(schema, rows.size(), std::move(columns)));
+  }
+  END_PARQUET_CATCH_EXCEPTIONS
+  return arrow::Table::FromRecordBatches(schema, batches);
+}
+
+// The `columns` (all of them if empty) of the rows where `column` equals `key`.
+inline arrow::Result<std::shared_ptr<arrow::Table>> lookup_parquet(
+    std::shared_ptr<arrow::io::RandomAccessFile> input, const std::string& column,
+    const std::shared_ptr<arrow::Scalar>& key, lookup_mode mode,
+    const std::vector<std::string>& columns = {}, lookup_stats* stats = nullptr,
+    arrow::MemoryPool* pool = arrow::default_memory_pool()) {
+  std::unique_ptr<parquet::ParquetFileReader> file;
+  PARQUET_CATCH_NOT_OK(file = parquet::ParquetFileReader::Open(input));
+  const auto metadata = file->metadata();
+
+  parquet::arrow::SchemaManifest manifest;
+  ARROW_RETURN_NOT_OK(parquet::arrow::SchemaManifest::Make(
+      metadata->schema(), metadata->key_value_metadata(),
+      parquet::default_arrow_reader_properties(), &manifest));
+
+  int key_field = -1;
+  std::vector<int> fields;
+  for (size_t i = 0; i < manifest.schema_fields.size(); ++i) {
+    const auto& name = manifest.schema_fields[i].field->name();
+    if (name == column) key_field = static_cast<int>(i);
+    if (columns.empty() ||
+        std::find(columns.begin(), columns.end(), name) != columns.end()) {
+      fields.push_back(static_cast<int>(i));
+    }
+  }
+  if (key_field == -1) return arrow::Status::KeyError("no column named ", column);
+  if (!manifest.schema_fields[key_field].is_leaf()) {
+    return arrow::Status::NotImplemented("lookups on nested column ", column);
+  }
+  // the column's type as stored, before the saved Arrow schema is applied
+  parquet::arrow::SchemaManifest stored;
+  ARROW_RETURN_NOT_OK(parquet::arrow::SchemaManifest::Make(
+      metadata->schema(), nullptr, parquet::default_arrow_reader_properties(), &stored));
+  const auto stored_type = stored.schema_fields[key_field].field->type();
+
+  lookup_stats ignored;
+  const auto physical_type =
+      metadata->schema()->Column(manifest.schema_fields[key_field].column_index)
+          ->physical_type();
+  return visit_physical_type(
+      physical_type,
+      [&](auto type) -> arrow::Result<std::shared_ptr<arrow::Table>> {
+        return lookup_parquet_typed<decltype(type)>(input, file.get(), manifest,
+                                                    key_field, key, stored_type, mode,
+                                                    fields, pool,
+                                                    stats ? stats : &ignored);
+      });
+}
@@ -0,0 +1,174 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <arrow/api.h>
+#include <arrow/compute/api.h>
+#include <arrow/io/api.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "parquet_lookup.h"
+#include "parquet_projected_reader.h"
+#include "parquet_tuned_writer.h"
+
+// Writes the taxi data with a sequential trip_id column added and page indexes
+// for every column, then times point lookups against it with a full scan, with
+// row groups pruned and with pages pruned. The lookups are for random trip ids,
+// which the statistics narrow down to one row group, and for a vendor that
+// never occurs but sorts between the ones that do. Only a bloom filter could
+// rule that one out, and this parquet writer doesn't write them, so the bloom
+// column stays at 0 unless the file comes from another writer. Pruning pages
+// saves decompressing and decoding them but not I/O, the column chunk is still
+// streamed past the skipped pages. The counts reported are per lookup.
+// Usage: parquet_lookup_bench [lookups], default 50.
+
+struct latency {
+  double mean_ms;
+  double p50_ms;
+  double max_ms;
+};
+
+latency summarize(std::vector<double> ms) {
+  if (ms.empty()) return {0, 0, 0};
+  std::sort(ms.begin(), ms.end());
+  double sum = 0;
+  for (double m : ms) sum += m;
+  return {sum / ms.size(), ms[ms.size() / 2], ms.back()};
+}
+
+const char* mode_name(lookup_mode mode) {
+  switch (mode) {
+    case lookup_mode::full_scan:
+      return "full scan";
+    case lookup_mode::row_group_pruned:
+      return "row groups pruned";
+    case lookup_mode::page_pruned:
+      return "pages pruned";
+  }
+  return "";
+}
+
+arrow::Status run(const std::string& path, const std::string& column,
+                  const std::vector<std::shared_ptr<arrow::Scalar>>& keys) {
+  const std::vector<std::string> columns{"trip_id", "pickup_at", "vendor_id",
+                                         "total_amount"};
+  std::cout << "lookups on " << column << "\n"
+            << "mode                mean ms   p50 ms   max ms  row groups  bloom  "
+            << "pages read    rows" << std::endl;
+
+  std::vector<std::shared_ptr<arrow::Table>> expected;
+  for (auto mode : {lookup_mode::full_scan, lookup_mode::row_group_pruned,
+                    lookup_mode::page_pruned}) {
+    lookup_stats stats;
+    std::vector<double> ms;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      const auto start = std::chrono::steady_clock::now();
+      ARROW_ASSIGN_OR_RAISE(auto input, arrow::io::ReadableFile::Open(path));
+      ARROW_ASSIGN_OR_RAISE(
+          auto table, lookup_parquet(input, column, keys[i], mode, columns, &stats));
+      ms.push_back(std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count());
+
+      // every mode has to find the same rows
+      ARROW_ASSIGN_OR_RAISE(table, table->CombineChunks());
+      if (mode == lookup_mode::full_scan) {
+        expected.push_back(table);
+      } else if (!table->Equals(*expected[i])) {
+        return arrow::Status::Invalid(mode_name(mode), " lookup of ",
+                                      keys[i]->ToString(), " differs from the full scan");
+      }
+    }
+
+    // the counts are per lookup
+    const double n = keys.size();
+    const auto summary = summarize(ms);
+    std::cout << std::left << std::setw(18) << mode_name(mode) << std::right
+              << std::fixed << std::setprecision(2) << std::setw(9) << summary.mean_ms
+              << std::setw(9) << summary.p50_ms << std::setw(9) << summary.max_ms
+              << std::setprecision(1) << std::setw(7) << stats.row_groups_read / n << "/"
+              << std::left << std::setw(5) << stats.row_groups / n << std::right
+              << std::setw(6) << stats.bloom_filter_pruned / n << std::setw(8)
+              << stats.pages_read / n << "/" << std::left << std::setw(8)
+              << stats.pages / n << std::right << std::setw(8) << stats.rows / n
+              << std::defaultfloat << std::endl;
+  }
+  std::cout << std::endl;
+  return arrow::Status::OK();
+}
+
+arrow::Status bench(int lookups) {
+  ARROW_ASSIGN_OR_RAISE(
+      auto input,
+      arrow::io::ReadableFile::Open("../../sample_data/yellow_tripdata_2015-01.parquet"));
+  ARROW_ASSIGN_OR_RAISE(auto table, read_parquet_projected(input));
+
+  arrow::Int64Builder ids;
+  for (int64_t i = 0; i < table->num_rows(); ++i) ARROW_RETURN_NOT_OK(ids.Append(i));
+  ARROW_ASSIGN_OR_RAISE(auto trip_id, ids.Finish());
+  ARROW_ASSIGN_OR_RAISE(
+      table, table->AddColumn(0, arrow::field("trip_id", arrow::int64()),
+                              std::make_shared<arrow::ChunkedArray>(trip_id)));
+
+  const std::string path = "taxi_lookup.parquet";
+  parquet_write_options options;
+  options.row_group_bytes = int64_t{8} << 20;
+  options.page_bytes = int64_t{64} << 10;
+  options.lookup_indexes = true;
+  ARROW_ASSIGN_OR_RAISE(auto output, arrow::io::FileOutputStream::Open(path));
+  ARROW_RETURN_NOT_OK(write_parquet_tuned(*table, output, options));
+  ARROW_RETURN_NOT_OK(output->Close());
+  std::cout << table->num_rows() << " rows written to " << path
+            << " with page indexes\n"
+            << "bloom filters are read-only here: used when a file has them, but "
+               "this parquet writer can't write them\n"
+            << "pruned pages are skipped before decoding, their bytes are still "
+               "read\n"
+            << std::endl;
+
+  std::mt19937_64 gen{42};
+  std::uniform_int_distribution<int64_t> pick(0, table->num_rows() - 1);
+  std::vector<std::shared_ptr<arrow::Scalar>> trip_ids;
+  for (int i = 0; i < lookups; ++i) {
+    trip_ids.push_back(arrow::MakeScalar(pick(gen)));
+  }
+  ARROW_RETURN_NOT_OK(run(path, "trip_id", trip_ids));
+
+  // sorts between CMT and VTS
+  std::vector<std::shared_ptr<arrow::Scalar>> vendors(lookups, arrow::MakeScalar("NYC"));
+  return run(path, "vendor_id", vendors);
+}
+
+int main(int argc, char** argv) {
+  auto status = bench(argc > 1 ? std::max(1, std::atoi(argv[1])) : 50);
+  if (!status.ok()) {
+    std::cerr << status.ToString() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,198 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/io/caching.h>
+#include <arrow/io/interfaces.h>
+#include <arrow/table.h>
+#include <arrow/util/async_generator.h>
+#include <arrow/util/thread_pool.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/metadata.h>
+#include <parquet/schema.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct parquet_read_options {
+  // top level columns to read, empty for all of them. They come back in the
+  // order they have in the file.
+  std::vector<std::string> columns;
+  // row groups to read, empty for all of them
+  std::vector<int> row_groups;
+  // fetch the selected column chunks of a row group when it is requested,
+  // coalescing nearby ranges into fewer, larger reads, instead of one read per
+  // page as decoding goes. The lazy cache (what Arrow datasets uses) only
+  // fetches the row groups being decoded, an eager one would issue the reads
+  // of the whole selection at once and hold all of it in memory.
+  bool pre_buffer = true;
+  arrow::io::CacheOptions cache_options = arrow::io::CacheOptions::LazyDefaults();
+  // row groups fetched and decoded at the same time, 0 for the CPU thread pool
+  // capacity
+  int row_group_readahead = 0;
+};
+
+// what the selection amounted to, in compressed column chunk bytes
+struct parquet_read_stats {
+  int64_t bytes_selected = 0;
+  int64_t bytes_in_file = 0;
+};
+
+struct parquet_batch_generator {
+  // the selected columns
+  std::shared_ptr<arrow::Schema> schema;
+  // yields the batches of each row group in file order
+  arrow::AsyncGenerator<std::shared_ptr<arrow::RecordBatch>> generator;
+};
+
+// The batches of the selected columns of the selected row groups, produced
+// asynchronously: the column chunks of the row groups coming up are fetched
+// on the I/O thread pool, coalesced into a few large reads, while the ones
+// already fetched are decoded on the CPU thread pool, several row groups in
+// flight at once and the columns of each decoded in parallel too.
+//
+// row_group_readahead bounds the I/O as well as the decoding. With the lazy
+// cache a row group's chunks are only fetched once the generator asks for
+// that row group, which it does for row_group_readahead of them at a time,
+// and the cache prefetches about as many row groups again behind them. Past
+// the footer nothing is read until the generator is first called. An eager
+// cache instead reads the whole selection as soon as the generator is made.
+inline arrow::Result<parquet_batch_generator> make_parquet_batch_generator(
+    std::shared_ptr<arrow::io::RandomAccessFile> input,
+    const parquet_read_options& options = {},
+    arrow::MemoryPool* pool = arrow::default_memory_pool(),
+    parquet_read_stats* stats = nullptr) {
+  parquet::arrow::FileReaderBuilder builder;
+  ARROW_RETURN_NOT_OK(builder.Open(std::move(input)));
+  auto metadata = builder.raw_reader()->metadata();
+  const auto* parquet_schema = metadata->schema();
+
+  // a nested column is made of several leaf columns, take all of them
+  std::vector<int> column_indices;
+  for (int c = 0; c < metadata->num_columns(); ++c) {
+    const auto& name = parquet_schema->GetColumnRoot(c)->name();
+    if (options.columns.empty() ||
+        std::find(options.columns.begin(), options.columns.end(), name) !=
+            options.columns.end()) {
+      column_indices.push_back(c);
+    }
+  }
+  for (const auto& name : options.columns) {
+    if (parquet_schema->group_node()->FieldIndex(name) == -1) {
+      return arrow::Status::KeyError("no column named ", name);
+    }
+  }
+
+  std::vector<int> row_groups = options.row_groups;
+  if (row_groups.empty()) {
+    for (int i = 0; i < metadata->num_row_groups(); ++i) row_groups.push_back(i);
+  }
+
+  int64_t max_rows = 0;
+  int64_t max_bytes = 0;
+  for (int rg : row_groups) {
+    if (rg < 0 || rg >= metadata->num_row_groups()) {
+      return arrow::Status::IndexError("no row group ", rg);
+    }
+    auto row_group = metadata->RowGroup(rg);
+    max_rows = std::max(max_rows, row_group->num_rows());
+    int64_t bytes = 0;
+    for (int c : column_indices) {
+      bytes += row_group->ColumnChunk(c)->total_compressed_size();
+    }
+    max_bytes = std::max(max_bytes, bytes);
+    if (stats) stats->bytes_selected += bytes;
+  }
+  if (stats) {
+    for (int rg = 0; rg < metadata->num_row_groups(); ++rg) {
+      auto row_group = metadata->RowGroup(rg);
+      for (int c = 0; c < row_group->num_columns(); ++c) {
+        stats->bytes_in_file += row_group->ColumnChunk(c)->total_compressed_size();
+      }
+    }
+  }
+
+  auto* executor = arrow::internal::GetCpuThreadPool();
+  const int readahead = options.row_group_readahead > 0 ? options.row_group_readahead
+                                                       : executor->GetCapacity();
+  // Coalescing happens across row groups, the chunks of a whole column are
+  // adjacent, so a coalesced read is capped at the largest row group's share
+  // for one read not to pull in the row groups after it. With reads no larger
+  // than a row group, prefetching `readahead` of them keeps the fetched but not
+  // yet requested data to about `readahead` row groups.
+  auto cache_options = options.cache_options;
+  if (cache_options.lazy) {
+    cache_options.range_size_limit = std::max(
+        std::min(cache_options.range_size_limit, max_bytes),
+        cache_options.hole_size_limit + 1);
+    if (cache_options.prefetch_limit == 0) cache_options.prefetch_limit = readahead;
+  }
+
+  parquet::ArrowReaderProperties properties;
+  properties.set_pre_buffer(options.pre_buffer);
+  // the default I/O executor, with the pre-buffered chunks taken from `pool`
+  properties.set_io_context(arrow::io::IOContext(pool));
+  properties.set_cache_options(cache_options);
+  properties.set_use_threads(true);
+
+  std::unique_ptr<parquet::arrow::FileReader> unique_reader;
+  ARROW_RETURN_NOT_OK(
+      builder.memory_pool(pool)->properties(properties)->Build(&unique_reader));
+  // the generator needs shared ownership of the reader
+  std::shared_ptr<parquet::arrow::FileReader> reader = std::move(unique_reader);
+
+  std::shared_ptr<arrow::Schema> file_schema;
+  ARROW_RETURN_NOT_OK(reader->GetSchema(&file_schema));
+  arrow::FieldVector fields;
+  for (const auto& field : file_schema->fields()) {
+    if (options.columns.empty() ||
+        std::find(options.columns.begin(), options.columns.end(), field->name()) !=
+            options.columns.end()) {
+      fields.push_back(field);
+    }
+  }
+
+  // the generator keeps reading row groups ahead until this many rows are in
+  // flight, so size it to cover the readahead wanted of the largest row group
+  ARROW_ASSIGN_OR_RAISE(
+      auto generator, reader->GetRecordBatchGenerator(reader, row_groups, column_indices,
+                                                      executor, readahead * max_rows));
+  return parquet_batch_generator{arrow::schema(fields, file_schema->metadata()),
+                                 std::move(generator)};
+}
+
+// Reads only the selected columns of the selected row groups into a table,
+// see make_parquet_batch_generator().
+inline arrow::Result<std::shared_ptr<arrow::Table>> read_parquet_projected(
+    std::shared_ptr<arrow::io::RandomAccessFile> input,
+    const parquet_read_options& options = {},
+    arrow::MemoryPool* pool = arrow::default_memory_pool(),
+    parquet_read_stats* stats = nullptr) {
+  ARROW_ASSIGN_OR_RAISE(
+      auto source, make_parquet_batch_generator(std::move(input), options, pool, stats));
+  auto collected = arrow::CollectAsyncGenerator(std::move(source.generator));
+  ARROW_ASSIGN_OR_RAISE(auto batches, collected.result());
+  return arrow::Table::FromRecordBatches(source.schema, batches);
+}
@@ -22,31 +22,64 @@
 
 #include <arrow/io/api.h>
 #include <arrow/table.h>
+#include <arrow/util/compression.h>
 #include <parquet/arrow/reader.h>
 #include <parquet/arrow/writer.h>
+#include <cstring>
 #include <iostream>
 
+#include "../../chapter1/cpp/tracking_memory_pool.h"
+#include "async_output_stream.h"
+#include "input_file.h"
+#include "parquet_projected_reader.h"
+#include "parquet_tuned_writer.h"
+
 int main(int argc, char** argv) {
-  PARQUET_ASSIGN_OR_THROW(auto input, arrow::io::ReadableFile::Open(
-                                          "../../sample_data/train.parquet"));
-
-  std::unique_ptr<parquet::arrow::FileReader> arrow_reader;
-  auto status = parquet::arrow::OpenFile(input, arrow::default_memory_pool(),
-                                         &arrow_reader);
-  if (!status.ok()) {
-    std::cerr << status.message() << std::endl;
+  // parquet_reader_writer --mmap maps the file instead of reading it, the
+  // column chunks are then sliced out of the mapping instead of being copied
+  // and only the decoded columns take memory from the pool
+  const input_mode mode = parse_input_mode(argc, argv);
+  // --tuned sizes the row groups and pages in bytes and picks the encoding and
+  // codec per column, rather than 1024 row row groups with the defaults
+  const bool tuned = argc > 1 && std::strcmp(argv[1], "--tuned") == 0;
+  report_memory_at_exit();
+
+  PARQUET_ASSIGN_OR_THROW(auto input, open_input("../../sample_data/train.parquet",
+                                                 mode, access_hint::willneed));
+
+  // every column, but with the column chunks pre-buffered and the row groups
+  // decoded concurrently instead of one after the other
+  auto maybe_table = read_parquet_projected(input, parquet_read_options{},
+                                            tracked_pool("parquet_decode"));
+  if (!maybe_table.ok()) {
+    std::cerr << maybe_table.status().message() << std::endl;
     return 1;
   }
 
-  std::shared_ptr<arrow::Table> table;
-  PARQUET_THROW_NOT_OK(arrow_reader->ReadTable(&table));
+  std::shared_ptr<arrow::Table> table = *maybe_table;
 
   std::cout << table->ToString() << std::endl;
 
-  PARQUET_ASSIGN_OR_THROW(auto outfile,
+  PARQUET_ASSIGN_OR_THROW(auto file,
                           arrow::io::FileOutputStream::Open("train.parquet"));
-  int64_t chunk_size = 1024;
-  PARQUET_THROW_NOT_OK(parquet::arrow::WriteTable(
-      *table, arrow::default_memory_pool(), outfile, chunk_size));
+  // encode the next pages while the previous ones are written out
+  PARQUET_ASSIGN_OR_THROW(auto outfile, AsyncOutputStream::Create(file));
+  if (tuned) {
+    std::vector<parquet_column_choice> choices;
+    PARQUET_THROW_NOT_OK(write_parquet_tuned(*table, outfile, parquet_write_options{},
+                                             tracked_pool("parquet_encode"), &choices));
+    for (const auto& choice : choices) {
+      std::cout << choice.name << ": "
+                << (choice.dictionary ? "dictionary"
+                                      : parquet::EncodingToString(choice.encoding))
+                << ", " << arrow::util::Codec::GetCodecAsString(choice.compression)
+                << std::endl;
+    }
+  } else {
+    int64_t chunk_size = 1024;
+    PARQUET_THROW_NOT_OK(parquet::arrow::WriteTable(
+        *table, tracked_pool("parquet_encode"), outfile, chunk_size));
+  }
   PARQUET_THROW_NOT_OK(outfile->Close());
+  std::cout << "parquet write: " << outfile->stats() << std::endl;
 }
\ No newline at end of file
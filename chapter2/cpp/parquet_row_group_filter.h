@@ -0,0 +1,228 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <arrow/compute/api.h>
+#include <arrow/compute/expression.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/arrow/schema.h>
+#include <parquet/file_reader.h>
+#include <parquet/metadata.h>
+#include <parquet/statistics.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "parquet_projected_reader.h"
+
+struct pruning_stats {
+  int row_groups = 0;
+  int row_groups_pruned = 0;
+  // compressed column chunk bytes of the columns being read
+  int64_t bytes = 0;
+  int64_t bytes_pruned = 0;
+};
+
+// What the statistics of a row group promise about its values: every column
+// the filter references with statistics contributes min <= col <= max (or
+// null, if it has any) or is_null when the row group holds nothing but nulls.
+inline arrow::compute::Expression row_group_guarantee(
+    const parquet::RowGroupMetaData& row_group,
+    const parquet::arrow::SchemaManifest& manifest,
+    const std::vector<int>& referenced_fields) {
+  namespace cp = arrow::compute;
+  std::vector<cp::Expression> conjunction;
+  for (int i : referenced_fields) {
+    const auto& schema_field = manifest.schema_fields[i];
+    // nested columns have a set of statistics per leaf, leave them be
+    if (!schema_field.is_leaf()) continue;
+    const auto& field = schema_field.field;
+    auto stats = row_group.ColumnChunk(schema_field.column_index)->statistics();
+    if (!stats) continue;
+
+    const auto ref = cp::field_ref(field->name());
+    if (stats->HasNullCount() && stats->null_count() == row_group.num_rows()) {
+      conjunction.push_back(cp::is_null(ref));
+      continue;
+    }
+    if (!stats->HasMinMax()) continue;
+
+    std::shared_ptr<arrow::Scalar> min, max;
+    if (!parquet::arrow::StatisticsAsScalars(*stats, &min, &max).ok()) continue;
+    // the scalars come out in the physical type, int64 for a timestamp say
+    auto typed_min = min->CastTo(field->type());
+    auto typed_max = max->CastTo(field->type());
+    if (!typed_min.ok() || !typed_max.ok()) continue;
+
+    auto range = cp::and_(cp::greater_equal(ref, cp::literal(*typed_min)),
+                          cp::less_equal(ref, cp::literal(*typed_max)));
+    if (!stats->HasNullCount() || stats->null_count() > 0) {
+      range = cp::or_(std::move(range), cp::is_null(ref));
+    }
+    conjunction.push_back(std::move(range));
+  }
+  return conjunction.empty() ? cp::literal(true) : cp::and_(conjunction);
+}
+
+// The row groups of `candidates` (all of them if empty) that may hold rows
+// matching `filter`, going by their statistics alone. Row groups without
+// usable statistics are always kept.
+inline arrow::Result<std::vector<int>> prune_row_groups(
+    const parquet::FileMetaData& metadata, const arrow::compute::Expression& filter,
+    const std::vector<std::string>& columns = {}, std::vector<int> candidates = {},
+    pruning_stats* stats = nullptr) {
+  parquet::arrow::SchemaManifest manifest;
+  ARROW_RETURN_NOT_OK(parquet::arrow::SchemaManifest::Make(
+      metadata.schema(), metadata.key_value_metadata(),
+      parquet::default_arrow_reader_properties(), &manifest));
+  arrow::FieldVector fields;
+  for (const auto& schema_field : manifest.schema_fields) {
+    fields.push_back(schema_field.field);
+  }
+  const auto schema = arrow::schema(std::move(fields));
+  ARROW_ASSIGN_OR_RAISE(auto bound, filter.Bind(*schema));
+
+  std::vector<int> referenced_fields;
+  for (const auto& ref : arrow::compute::FieldsInExpression(bound)) {
+    ARROW_ASSIGN_OR_RAISE(auto path, ref.FindOne(*schema));
+    referenced_fields.push_back(path[0]);
+  }
+
+  // the bytes a read of these columns would fetch
+  std::vector<int> leaves;
+  for (int c = 0; c < metadata.num_columns(); ++c) {
+    const parquet::arrow::SchemaField* field = nullptr;
+    ARROW_RETURN_NOT_OK(manifest.GetColumnField(c, &field));
+    while (auto parent = manifest.GetParent(field)) field = parent;
+    if (columns.empty() || std::find(columns.begin(), columns.end(),
+                                     field->field->name()) != columns.end()) {
+      leaves.push_back(c);
+    }
+  }
+
+  if (candidates.empty()) {
+    for (int i = 0; i < metadata.num_row_groups(); ++i) candidates.push_back(i);
+  }
+  std::vector<int> kept;
+  for (int i : candidates) {
+    auto row_group = metadata.RowGroup(i);
+    ARROW_ASSIGN_OR_RAISE(
+        auto simplified,
+        arrow::compute::SimplifyWithGuarantee(
+            bound, row_group_guarantee(*row_group, manifest, referenced_fields)));
+    const bool pruned = !simplified.IsSatisfiable();
+    if (!pruned) kept.push_back(i);
+    if (!stats) continue;
+
+    int64_t bytes = 0;
+    for (int c : leaves) bytes += row_group->ColumnChunk(c)->total_compressed_size();
+    ++stats->row_groups;
+    stats->bytes += bytes;
+    if (pruned) {
+      ++stats->row_groups_pruned;
+      stats->bytes_pruned += bytes;
+    }
+  }
+  return kept;
+}
+
+// the rows of `table` matching `filter`
+inline arrow::Result<std::shared_ptr<arrow::Table>> filter_table(
+    const std::shared_ptr<arrow::Table>& table, const arrow::compute::Expression& filter,
+    arrow::MemoryPool* pool = arrow::default_memory_pool()) {
+  namespace cp = arrow::compute;
+  cp::ExecContext ctx(pool);
+  ARROW_ASSIGN_OR_RAISE(auto bound, filter.Bind(*table->schema(), &ctx));
+  arrow::RecordBatchVector batches;
+  arrow::TableBatchReader batch_reader(*table);
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while (true) {
+    ARROW_RETURN_NOT_OK(batch_reader.ReadNext(&batch));
+    if (!batch) break;
+    ARROW_ASSIGN_OR_RAISE(auto mask, cp::ExecuteScalarExpression(bound, *table->schema(),
+                                                                 batch, &ctx));
+    ARROW_ASSIGN_OR_RAISE(auto filtered,
+                          cp::Filter(batch, mask, cp::FilterOptions::Defaults(), &ctx));
+    batches.push_back(filtered.record_batch());
+  }
+  return arrow::Table::FromRecordBatches(table->schema(), batches);
+}
+
+// read_parquet_projected() restricted to the rows matching `filter`. Row
+// groups whose statistics rule the filter out are never read, the rest are
+// read and filtered row by row. The columns the filter needs are read as well
+// but only options.columns are returned.
+inline arrow::Result<std::shared_ptr<arrow::Table>> read_parquet_filtered(
+    std::shared_ptr<arrow::io::RandomAccessFile> input,
+    const arrow::compute::Expression& filter, parquet_read_options options = {},
+    arrow::MemoryPool* pool = arrow::default_memory_pool(),
+    pruning_stats* stats = nullptr) {
+  namespace cp = arrow::compute;
+  std::shared_ptr<parquet::FileMetaData> metadata;
+  PARQUET_CATCH_NOT_OK(metadata = parquet::ReadMetaData(input));
+
+  // the filter columns are read too, so they count towards the pruned bytes
+  const auto wanted = options.columns;
+  if (!wanted.empty()) {
+    for (const auto& ref : cp::FieldsInExpression(filter)) {
+      if (ref.name() && std::find(options.columns.begin(), options.columns.end(),
+                                  *ref.name()) == options.columns.end()) {
+        options.columns.push_back(*ref.name());
+      }
+    }
+  }
+  ARROW_ASSIGN_OR_RAISE(options.row_groups,
+                        prune_row_groups(*metadata, filter, options.columns,
+                                         std::move(options.row_groups), stats));
+  if (options.row_groups.empty() && metadata->num_row_groups() > 0) {
+    // nothing can match, hand back the columns asked for without any rows
+    std::shared_ptr<arrow::Schema> schema;
+    ARROW_RETURN_NOT_OK(parquet::arrow::FromParquetSchema(
+        metadata->schema(), parquet::default_arrow_reader_properties(),
+        metadata->key_value_metadata(), &schema));
+    arrow::FieldVector fields;
+    for (const auto& field : schema->fields()) {
+      if (wanted.empty() ||
+          std::find(wanted.begin(), wanted.end(), field->name()) != wanted.end()) {
+        fields.push_back(field);
+      }
+    }
+    return arrow::Table::MakeEmpty(arrow::schema(fields, schema->metadata()), pool);
+  }
+
+  ARROW_ASSIGN_OR_RAISE(auto table, read_parquet_projected(input, options, pool));
+  ARROW_ASSIGN_OR_RAISE(table, filter_table(table, filter, pool));
+
+  if (wanted.empty()) return table;
+  std::vector<int> indices;
+  for (int i = 0; i < table->num_columns(); ++i) {
+    if (std::find(wanted.begin(), wanted.end(), table->field(i)->name()) !=
+        wanted.end()) {
+      indices.push_back(i);
+    }
+  }
+  return table->SelectColumns(indices);
+}
@@ -0,0 +1,179 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <arrow/io/interfaces.h>
+#include <arrow/util/byte_size.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/properties.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+struct parquet_write_options {
+  // row groups and data pages are sized by bytes rather than by a row count,
+  // measured on the uncompressed Arrow data
+  int64_t row_group_bytes = int64_t{128} << 20;
+  int64_t page_bytes = int64_t{1} << 20;
+  arrow::Compression::type compression = arrow::Compression::SNAPPY;
+  // overrides the codec for the named columns
+  std::map<std::string, arrow::Compression::type> column_compression;
+  // pick an encoding per column from its type and how repetitive it is,
+  // otherwise every column is dictionary encoded falling back to PLAIN
+  bool choose_encodings = true;
+  // a column sampled with fewer distinct values than this fraction of the
+  // sample is dictionary encoded whatever its type
+  double dictionary_ratio = 0.05;
+  // write a page index for every column, for point lookups (see
+  // parquet_lookup.h)
+  bool lookup_indexes = false;
+};
+
+// The column and offset indexes let a reader go straight to the pages that can
+// hold a value. The offset index is written for every column so the other
+// columns of the matching rows can be fetched page by page too. The parquet
+// writer of the Arrow versions this targets can't write bloom filters, only
+// read them, so lookups use those only in files written by something else.
+inline void enable_lookup_indexes(parquet::WriterProperties::Builder* builder) {
+  builder->enable_write_page_index();
+}
+
+// what was picked for a column, for reporting
+struct parquet_column_choice {
+  std::string name;
+  bool dictionary;
+  parquet::Encoding::type encoding;
+  arrow::Compression::type compression;
+};
+
+// Distinct values among the first `sample` values of a fixed width column,
+// -1 when the column isn't one.
+inline int64_t sampled_distinct(const arrow::ChunkedArray& column, int64_t sample,
+                                int64_t* sampled) {
+  const auto* type = dynamic_cast<const arrow::FixedWidthType*>(column.type().get());
+  if (!type || type->bit_width() % 8 != 0 || type->bit_width() > 64) return -1;
+  const int width = type->bit_width() / 8;
+
+  std::unordered_set<uint64_t> seen;
+  *sampled = 0;
+  for (const auto& chunk : column.chunks()) {
+    const auto* values = chunk->data()->GetValues<uint8_t>(1, 0) +
+                         chunk->offset() * width;
+    for (int64_t i = 0; i < chunk->length() && *sampled < sample; ++i, ++*sampled) {
+      uint64_t value = 0;
+      std::memcpy(&value, values + i * width, width);
+      seen.insert(value);
+    }
+    if (*sampled == sample) break;
+  }
+  return static_cast<int64_t>(seen.size());
+}
+
+// Dictionary for strings and anything with few distinct values, delta
+// encoding for integers and timestamps, which tend to be sorted or clustered,
+// and byte stream split for floating point, which compresses far better once
+// the exponent bytes are grouped together.
+inline parquet_column_choice choose_column_encoding(const arrow::ChunkedArray& column,
+                                                    const std::string& name,
+                                                    const parquet_write_options& opts) {
+  parquet_column_choice choice{name, true, parquet::Encoding::PLAIN, opts.compression};
+  auto codec = opts.column_compression.find(name);
+  if (codec != opts.column_compression.end()) choice.compression = codec->second;
+  if (!opts.choose_encodings) return choice;
+
+  int64_t sampled = 0;
+  const int64_t distinct = sampled_distinct(column, 1 << 16, &sampled);
+  if (distinct < 0 || distinct < opts.dictionary_ratio * sampled) return choice;
+
+  switch (column.type()->id()) {
+    case arrow::Type::INT32:
+    case arrow::Type::INT64:
+    case arrow::Type::UINT32:
+    case arrow::Type::UINT64:
+    case arrow::Type::DATE32:
+    case arrow::Type::TIME32:
+    case arrow::Type::TIME64:
+    case arrow::Type::TIMESTAMP:
+      choice.dictionary = false;
+      choice.encoding = parquet::Encoding::DELTA_BINARY_PACKED;
+      break;
+    case arrow::Type::FLOAT:
+    case arrow::Type::DOUBLE:
+      choice.dictionary = false;
+      choice.encoding = parquet::Encoding::BYTE_STREAM_SPLIT;
+      break;
+    default:
+      break;
+  }
+  return choice;
+}
+
+// rows per row group that come closest to opts.row_group_bytes
+inline int64_t row_group_rows(const arrow::Table& table,
+                              const parquet_write_options& opts) {
+  if (table.num_rows() == 0) return 1;
+  const double row_bytes =
+      static_cast<double>(arrow::util::TotalBufferSize(table)) / table.num_rows();
+  return std::max<int64_t>(1, static_cast<int64_t>(opts.row_group_bytes / row_bytes));
+}
+
+inline std::shared_ptr<parquet::WriterProperties> make_writer_properties(
+    const arrow::Table& table, const parquet_write_options& opts,
+    std::vector<parquet_column_choice>* choices = nullptr) {
+  parquet::WriterProperties::Builder builder;
+  // the writer caps the rows per row group with this as well
+  builder.max_row_group_length(row_group_rows(table, opts))
+      ->data_pagesize(opts.page_bytes)
+      ->compression(opts.compression);
+  for (int i = 0; i < table.num_columns(); ++i) {
+    const auto& name = table.field(i)->name();
+    auto choice = choose_column_encoding(*table.column(i), name, opts);
+    builder.compression(name, choice.compression);
+    if (choice.dictionary) {
+      builder.enable_dictionary(name);
+    } else {
+      builder.disable_dictionary(name)->encoding(name, choice.encoding);
+    }
+    if (choices) choices->push_back(choice);
+  }
+  if (opts.lookup_indexes) enable_lookup_indexes(&builder);
+  return builder.build();
+}
+
+// Writes the table with row groups and pages sized in bytes and the encoding
+// and codec chosen per column, instead of a fixed row count and defaults.
+inline arrow::Status write_parquet_tuned(
+    const arrow::Table& table, std::shared_ptr<arrow::io::OutputStream> sink,
+    const parquet_write_options& opts = {},
+    arrow::MemoryPool* pool = arrow::default_memory_pool(),
+    std::vector<parquet_column_choice>* choices = nullptr) {
+  return parquet::arrow::WriteTable(table, pool, std::move(sink),
+                                    row_group_rows(table, opts),
+                                    make_writer_properties(table, opts, choices));
+}
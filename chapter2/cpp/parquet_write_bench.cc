@@ -0,0 +1,165 @@
+// MIT License
+//
+// Copyright (c) 2021 Packt
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <arrow/io/api.h>
+#include <arrow/table.h>
+#include <arrow/util/byte_size.h>
+#include <arrow/util/compression.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/file_reader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "parquet_projected_reader.h"
+#include "parquet_tuned_writer.h"
+
+// Rewrites the taxi data with every combination of row group size, page size,
+// codec and per-column encodings, after a first run with the chunk_size=1024
+// defaults the examples use. Reports the write throughput (in bytes of Arrow
+// data), the file size and the throughput of reading a few columns back.
+// Usage: parquet_write_bench [col,col,...], defaults to
+// passenger_count,total_amount,tip_amount.
+
+struct bench_result {
+  double write_secs;
+  int64_t file_size;
+  int64_t num_row_groups;
+  double read_mb_per_sec;
+};
+
+arrow::Result<bench_result> run(
+    const std::vector<std::string>& columns,
+    const std::function<arrow::Status(std::shared_ptr<arrow::io::OutputStream>)>& write) {
+  const std::string path = "taxi_bench.parquet";
+  bench_result result;
+
+  auto start = std::chrono::steady_clock::now();
+  ARROW_ASSIGN_OR_RAISE(auto output, arrow::io::FileOutputStream::Open(path));
+  ARROW_RETURN_NOT_OK(write(output));
+  ARROW_RETURN_NOT_OK(output->Close());
+  result.write_secs =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  parquet_read_options options;
+  options.columns = columns;
+  // the reads are short, keep the best of a few
+  for (int i = 0; i < 3; ++i) {
+    start = std::chrono::steady_clock::now();
+    ARROW_ASSIGN_OR_RAISE(auto input, arrow::io::ReadableFile::Open(path));
+    ARROW_ASSIGN_OR_RAISE(result.file_size, input->GetSize());
+    ARROW_ASSIGN_OR_RAISE(auto projected, read_parquet_projected(input, options));
+    const double secs =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double mb_per_sec = arrow::util::TotalBufferSize(*projected) / secs / (1 << 20);
+    result.read_mb_per_sec = std::max(i == 0 ? 0 : result.read_mb_per_sec, mb_per_sec);
+  }
+
+  ARROW_ASSIGN_OR_RAISE(auto input, arrow::io::ReadableFile::Open(path));
+  result.num_row_groups = parquet::ReadMetaData(input)->num_row_groups();
+  return result;
+}
+
+std::string size_label(int64_t bytes) {
+  return bytes >= (1 << 20) ? std::to_string(bytes >> 20) + "MB"
+                            : std::to_string(bytes >> 10) + "KB";
+}
+
+void print(const std::string& row_group, const std::string& page,
+           arrow::Compression::type codec, const std::string& encodings,
+           const arrow::Result<bench_result>& result, double table_mb) {
+  std::cout << std::left << std::setw(11) << row_group << std::setw(7) << page
+            << std::setw(14) << arrow::util::Codec::GetCodecAsString(codec)
+            << std::setw(12) << encodings;
+  if (!result.ok()) {
+    std::cout << "  " << result.status().ToString() << std::endl;
+    return;
+  }
+  std::cout << std::right << std::fixed << std::setprecision(1) << std::setw(6)
+            << result->num_row_groups << std::setw(12) << table_mb / result->write_secs
+            << std::setw(10) << result->file_size / double(1 << 20) << std::setw(12)
+            << result->read_mb_per_sec << std::defaultfloat << std::endl;
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> columns;
+  std::stringstream list(argc > 1 ? argv[1] : "passenger_count,total_amount,tip_amount");
+  for (std::string col; std::getline(list, col, ',');) columns.push_back(col);
+
+  auto input =
+      arrow::io::ReadableFile::Open("../../sample_data/yellow_tripdata_2015-01.parquet")
+          .ValueOrDie();
+  auto table = read_parquet_projected(input).ValueOrDie();
+  const double table_mb = arrow::util::TotalBufferSize(*table) / double(1 << 20);
+  std::cout << table->num_rows() << " rows, " << table_mb << " MB in memory\n\n";
+
+  std::vector<parquet_column_choice> choices;
+  make_writer_properties(*table, parquet_write_options{}, &choices);
+  std::cout << "chosen encodings:\n";
+  for (const auto& choice : choices) {
+    std::cout << "  " << std::left << std::setw(24) << choice.name
+              << (choice.dictionary ? "dictionary"
+                                    : parquet::EncodingToString(choice.encoding))
+              << std::endl;
+  }
+
+  std::cout << "\nrow group  page   codec         encodings   "
+            << "groups  write MB/s   file MB  read MB/s (" << columns.size() << " cols)"
+            << std::endl;
+
+  // WriteTable without properties, which doesn't compress
+  print("1024 rows", "1MB", arrow::Compression::UNCOMPRESSED, "default",
+        run(columns,
+            [&](std::shared_ptr<arrow::io::OutputStream> output) {
+              return parquet::arrow::WriteTable(*table, arrow::default_memory_pool(),
+                                                output, 1024);
+            }),
+        table_mb);
+
+  for (int64_t row_group_bytes : {int64_t{16} << 20, int64_t{128} << 20}) {
+    for (int64_t page_bytes : {int64_t{64} << 10, int64_t{1} << 20}) {
+      for (auto codec : {arrow::Compression::UNCOMPRESSED, arrow::Compression::SNAPPY,
+                         arrow::Compression::LZ4, arrow::Compression::ZSTD}) {
+        for (bool choose : {false, true}) {
+          parquet_write_options options;
+          options.row_group_bytes = row_group_bytes;
+          options.page_bytes = page_bytes;
+          options.compression = codec;
+          options.choose_encodings = choose;
+          print(size_label(row_group_bytes), size_label(page_bytes), codec,
+                choose ? "chosen" : "default",
+                run(columns,
+                    [&](std::shared_ptr<arrow::io::OutputStream> output) {
+                      return write_parquet_tuned(*table, output, options);
+                    }),
+                table_mb);
+        }
+      }
+    }
+  }
+}
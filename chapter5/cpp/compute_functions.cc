@@ -29,15 +29,28 @@
 #include <parquet/arrow/reader.h>
 #include <iostream>
 
-arrow::Status compute_parquet() {
-  constexpr auto filepath = "../../sample_data/yellow_tripdata_2015-01.parquet";
+#include "../../chapter2/cpp/parquet_projected_reader.h"
+#include "../../chapter2/cpp/parquet_row_group_filter.h"
+
+// reads only the named columns (all of them if none are given), so the
+// column chunks of everything else are never fetched or decoded
+arrow::Result<std::shared_ptr<arrow::Table>> read_columns(
+    const std::string& filepath, std::vector<std::string> columns = {}) {
   ARROW_ASSIGN_OR_RAISE(auto input, arrow::io::ReadableFile::Open(filepath));
-  std::unique_ptr<parquet::arrow::FileReader> reader;
-  RETURN_NOT_OK(
-      parquet::arrow::OpenFile(input, arrow::default_memory_pool(), &reader));
+  parquet_read_options options;
+  options.columns = std::move(columns);
+  parquet_read_stats stats;
+  ARROW_ASSIGN_OR_RAISE(
+      auto table,
+      read_parquet_projected(input, options, arrow::default_memory_pool(), &stats));
+  std::cout << "read " << stats.bytes_selected << " of " << stats.bytes_in_file
+            << " column chunk bytes" << std::endl;
+  return table;
+}
 
-  std::shared_ptr<arrow::Table> table;
-  RETURN_NOT_OK(reader->ReadTable(&table));
+arrow::Status compute_parquet() {
+  constexpr auto filepath = "../../sample_data/yellow_tripdata_2015-01.parquet";
+  ARROW_ASSIGN_OR_RAISE(auto table, read_columns(filepath, {"total_amount"}));
   std::shared_ptr<arrow::ChunkedArray> column =
       table->GetColumnByName("total_amount");
   std::cout << column->ToString() << std::endl;
@@ -57,13 +70,7 @@ arrow::Status compute_parquet() {
 
 arrow::Status find_minmax() {
   constexpr auto filepath = "../../sample_data/yellow_tripdata_2015-01.parquet";
-  ARROW_ASSIGN_OR_RAISE(auto input, arrow::io::ReadableFile::Open(filepath));
-  std::unique_ptr<parquet::arrow::FileReader> reader;
-  RETURN_NOT_OK(
-      parquet::arrow::OpenFile(input, arrow::default_memory_pool(), &reader));
-
-  std::shared_ptr<arrow::Table> table;
-  RETURN_NOT_OK(reader->ReadTable(&table));
+  ARROW_ASSIGN_OR_RAISE(auto table, read_columns(filepath, {"total_amount"}));
   std::shared_ptr<arrow::ChunkedArray> column =
       table->GetColumnByName("total_amount");
   std::cout << column->ToString() << std::endl;
@@ -79,13 +86,7 @@ arrow::Status find_minmax() {
 
 arrow::Status sort_table() {
   constexpr auto filepath = "../../sample_data/yellow_tripdata_2015-01.parquet";
-  ARROW_ASSIGN_OR_RAISE(auto input, arrow::io::ReadableFile::Open(filepath));
-  std::unique_ptr<parquet::arrow::FileReader> reader;
-  RETURN_NOT_OK(
-      parquet::arrow::OpenFile(input, arrow::default_memory_pool(), &reader));
-
-  std::shared_ptr<arrow::Table> table;
-  RETURN_NOT_OK(reader->ReadTable(&table));
+  ARROW_ASSIGN_OR_RAISE(auto table, read_columns(filepath));
 
   arrow::compute::SortOptions sort_opts;
   sort_opts.sort_keys = {arrow::compute::SortKey{
@@ -102,7 +103,39 @@ arrow::Status sort_table() {
   return arrow::Status::OK();
 }
 
+arrow::Status filter_parquet() {
+  constexpr auto filepath = "../../sample_data/yellow_tripdata_2015-01.parquet";
+  ARROW_ASSIGN_OR_RAISE(auto input, arrow::io::ReadableFile::Open(filepath));
+
+  // the trips picked up on the 10th, the file is sorted by pickup time so
+  // most of its row groups can be skipped on their statistics alone
+  namespace cp = arrow::compute;
+  auto type = arrow::timestamp(arrow::TimeUnit::MICRO);
+  ARROW_ASSIGN_OR_RAISE(auto start, arrow::Scalar::Parse(type, "2015-01-10 00:00:00"));
+  ARROW_ASSIGN_OR_RAISE(auto end, arrow::Scalar::Parse(type, "2015-01-11 00:00:00"));
+  auto pickup_at = cp::field_ref("pickup_at");
+  auto filter = cp::and_(cp::greater_equal(pickup_at, cp::literal(start)),
+                         cp::less(pickup_at, cp::literal(end)));
+
+  parquet_read_options options;
+  options.columns = {"total_amount"};
+  pruning_stats stats;
+  ARROW_ASSIGN_OR_RAISE(auto table, read_parquet_filtered(input, filter, options,
+                                                          arrow::default_memory_pool(),
+                                                          &stats));
+  std::cout << "pruned " << stats.row_groups_pruned << " of " << stats.row_groups
+            << " row groups, " << stats.bytes_pruned << " of " << stats.bytes
+            << " bytes" << std::endl;
+
+  ARROW_ASSIGN_OR_RAISE(arrow::Datum total,
+                        arrow::compute::Sum(table->GetColumnByName("total_amount")));
+  std::cout << table->num_rows() << " trips, total " << total.scalar()->ToString()
+            << std::endl;
+  return arrow::Status::OK();
+}
+
 int main(int argc, char** argv) {
   PARQUET_THROW_NOT_OK(compute_parquet());
   PARQUET_THROW_NOT_OK(find_minmax());
+  PARQUET_THROW_NOT_OK(filter_parquet());
 }
\ No newline at end of file
@@ -29,24 +29,47 @@
 #include <arrow/result.h>
 #include <arrow/status.h>
 #include <arrow/table.h>
+#include <arrow/util/async_generator.h>
 #include <parquet/arrow/reader.h>
 
+#include <cstdlib>
+#include <optional>
+
+#include "../../chapter1/cpp/tracking_memory_pool.h"
+#include "../../chapter2/cpp/parquet_projected_reader.h"
+
 namespace aio = ::arrow::io;
 namespace cp = ::arrow::compute;
 namespace ac = ::arrow::acero;
 
-arrow::Status simple_acero(std::string path) {
-  auto* pool = arrow::default_memory_pool();
+// An asynchronous source node for the columns of a parquet file. Unlike the
+// record_batch_reader_source over GetRecordBatchReader, where reading a row
+// group waits for the previous one to be decoded, the next `readahead` row
+// groups (0 for as many as there are CPU threads) are fetched on the I/O
+// thread pool while the ones already fetched are decoded on the CPU threads.
+// Building the declaration only reads the footer, the column chunks are
+// fetched once the plan runs and pulls batches from the source.
+arrow::Result<ac::Declaration> parquet_source(const std::string& path,
+                                              std::vector<std::string> columns,
+                                              int readahead, arrow::MemoryPool* pool) {
   ARROW_ASSIGN_OR_RAISE(auto input, aio::ReadableFile::Open(path));
+  parquet_read_options options;
+  options.columns = std::move(columns);
+  options.row_group_readahead = readahead;
+  ARROW_ASSIGN_OR_RAISE(auto source, make_parquet_batch_generator(input, options, pool));
+
+  auto batches = arrow::MakeMappedGenerator(
+      std::move(source.generator), [](const std::shared_ptr<arrow::RecordBatch>& batch) {
+        return std::optional<cp::ExecBatch>(cp::ExecBatch(*batch));
+      });
+  return ac::Declaration{"source",
+                         ac::SourceNodeOptions{source.schema, std::move(batches)}};
+}
 
-  std::unique_ptr<parquet::arrow::FileReader> arrow_reader;
-  ARROW_RETURN_NOT_OK(parquet::arrow::OpenFile(input, pool, &arrow_reader));
-
-  std::unique_ptr<arrow::RecordBatchReader> rdr;
-  ARROW_RETURN_NOT_OK(arrow_reader->GetRecordBatchReader(&rdr));
-
-  ac::Declaration reader_source("record_batch_reader_source",
-                                ac::RecordBatchReaderSourceNodeOptions{std::move(rdr)});
+arrow::Status simple_acero(std::string path, int readahead) {
+  ARROW_ASSIGN_OR_RAISE(auto reader_source,
+                        parquet_source(path, {"name", "species", "homeworld"}, readahead,
+                                       tracked_pool("parquet_decode")));
 
   ac::Declaration project{
       "project",
@@ -54,23 +77,17 @@ arrow::Status simple_acero(std::string path) {
       ac::ProjectNodeOptions(
           {cp::field_ref("name"), cp::field_ref("species"), cp::field_ref("homeworld")})};
 
-  ARROW_ASSIGN_OR_RAISE(auto result, ac::DeclarationToTable(std::move(project)));
+  ARROW_ASSIGN_OR_RAISE(auto result,
+                        ac::DeclarationToTable(std::move(project), /*use_threads=*/true,
+                                               tracked_pool("acero_project")));
   std::cout << "Results: " << result->ToString() << std::endl;
   return arrow::Status::OK();
 }
 
-arrow::Status complex_plan(std::string path) {
-  auto* pool = arrow::default_memory_pool();
-  ARROW_ASSIGN_OR_RAISE(auto input, aio::ReadableFile::Open(path));
-
-  std::unique_ptr<parquet::arrow::FileReader> arrow_reader;
-  ARROW_RETURN_NOT_OK(parquet::arrow::OpenFile(input, pool, &arrow_reader));
-
-  std::unique_ptr<arrow::RecordBatchReader> rdr;
-  ARROW_RETURN_NOT_OK(arrow_reader->GetRecordBatchReader(&rdr));
-
-  ac::Declaration reader_source{"record_batch_reader_source",
-                                ac::RecordBatchReaderSourceNodeOptions{std::move(rdr)}};
+arrow::Status complex_plan(std::string path, int readahead) {
+  ARROW_ASSIGN_OR_RAISE(auto reader_source,
+                        parquet_source(path, {"name", "homeworld"}, readahead,
+                                       tracked_pool("parquet_decode")));
 
   ac::Declaration agg_plan{
       "aggregate",
@@ -78,20 +95,18 @@ arrow::Status complex_plan(std::string path) {
       ac::AggregateNodeOptions({{{"hash_list", nullptr, "name", "name_list"}}},
                                {"homeworld"})};
 
-  ARROW_ASSIGN_OR_RAISE(auto result, ac::DeclarationToTable(std::move(agg_plan)));
+  ARROW_ASSIGN_OR_RAISE(auto result,
+                        ac::DeclarationToTable(std::move(agg_plan), /*use_threads=*/true,
+                                               tracked_pool("acero_aggregate")));
   std::cout << "Results: " << result->ToString() << std::endl;
   return arrow::Status::OK();
 }
 
-arrow::Status sequence_plan(std::string path) {
-  auto* pool = arrow::default_memory_pool();
-  ARROW_ASSIGN_OR_RAISE(auto input, aio::ReadableFile::Open(path));
-
-  std::unique_ptr<parquet::arrow::FileReader> arrow_reader;
-  ARROW_RETURN_NOT_OK(parquet::arrow::OpenFile(input, pool, &arrow_reader));
-
-  std::unique_ptr<arrow::RecordBatchReader> rdr;
-  ARROW_RETURN_NOT_OK(arrow_reader->GetRecordBatchReader(&rdr));
+arrow::Status sequence_plan(std::string path, int readahead) {
+  ARROW_ASSIGN_OR_RAISE(
+      auto reader_source,
+      parquet_source(path, {"name", "species", "height", "homeworld"}, readahead,
+                     tracked_pool("parquet_decode")));
 
   arrow::StringBuilder excl_bldr;
   ARROW_RETURN_NOT_OK(excl_bldr.Append("Skako"));
@@ -104,8 +119,7 @@ arrow::Status sequence_plan(std::string path) {
                                                   cp::SetLookupOptions{*exclusions})});
 
   auto plan = ac::Declaration::Sequence(
-      {{"record_batch_reader_source",
-        ac::RecordBatchReaderSourceNodeOptions{std::move(rdr)}},
+      {std::move(reader_source),
        {"filter", ac::FilterNodeOptions{std::move(filter_expr)}},
        {"aggregate",
         ac::AggregateNodeOptions({{{"hash_list", nullptr, "name", "name_list"},
@@ -113,13 +127,18 @@ arrow::Status sequence_plan(std::string path) {
                                    {"hash_mean", nullptr, "height", "avg_height"}}},
                                  {"homeworld"})}});
   
-  ARROW_ASSIGN_OR_RAISE(auto result, ac::DeclarationToTable(std::move(plan)));
+  ARROW_ASSIGN_OR_RAISE(auto result,
+                        ac::DeclarationToTable(std::move(plan), /*use_threads=*/true,
+                                               tracked_pool("acero_aggregate")));
   std::cout << "Results: " << result->ToString() << std::endl;
   return arrow::Status::OK();
 }
 
 int main(int argc, char** argv) {
-  // ARROW_UNUSED(simple_acero("../../sample_data/starwars.parquet"));
-  // ARROW_UNUSED(complex_plan("../../sample_data/starwars.parquet"));
-  ARROW_UNUSED(sequence_plan("../../sample_data/starwars.parquet"));
+  report_memory_at_exit();
+  // simple_acero [readahead], the row groups to read ahead of the plan
+  const int readahead = argc > 1 ? std::atoi(argv[1]) : 0;
+  // ARROW_UNUSED(simple_acero("../../sample_data/starwars.parquet", readahead));
+  // ARROW_UNUSED(complex_plan("../../sample_data/starwars.parquet", readahead));
+  ARROW_UNUSED(sequence_plan("../../sample_data/starwars.parquet", readahead));
 }
\ No newline at end of file
@@ -28,6 +28,8 @@
 #include <iostream>
 #include <memory>
 
+#include "../../chapter2/cpp/parquet_tuned_writer.h"
+
 #define ABORT_ON_FAIL(expr)                        \
   do {                                             \
     arrow::Status status_ = (expr);                \
@@ -65,16 +67,20 @@ std::string create_sample_dataset(
   auto base_path = root_path + "/parquet_dataset";
   ABORT_ON_FAIL(filesystem->CreateDir(base_path));
   auto table = create_table();
+  // page indexes so single values can be looked up without reading every page
+  parquet::WriterProperties::Builder builder;
+  enable_lookup_indexes(&builder);
+  auto properties = builder.build();
   auto output =
       filesystem->OpenOutputStream(base_path + "/data1.parquet").ValueOrDie();
   ABORT_ON_FAIL(parquet::arrow::WriteTable(*table->Slice(0, 5),
                                            arrow::default_memory_pool(), output,
-                                           /*chunk_size*/ 2048));
+                                           /*chunk_size*/ 2048, properties));
   output =
       filesystem->OpenOutputStream(base_path + "/data2.parquet").ValueOrDie();
   ABORT_ON_FAIL(parquet::arrow::WriteTable(*table->Slice(5),
                                            arrow::default_memory_pool(), output,
-                                           /*chunk_size*/ 2048));
+                                           /*chunk_size*/ 2048, properties));
   return base_path;
 }
 